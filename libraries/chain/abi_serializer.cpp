@@ -10,6 +10,7 @@
 #include <eosio/chain/asset.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/io/json.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <fc/io/varint.hpp>
 
@@ -104,7 +105,10 @@ namespace eosio { namespace chain {
       structs.clear();
       actions.clear();
       tables.clear();
+      table_index_types.clear();
       error_messages.clear();
+      compiled_types.clear();
+      compiled_type_index.clear();
 
       for( const auto& st : abi.structs )
          structs[st.name] = st;
@@ -118,8 +122,10 @@ namespace eosio { namespace chain {
       for( const auto& a : abi.actions )
          actions[a.name] = a.type;
 
-      for( const auto& t : abi.tables )
+      for( const auto& t : abi.tables ) {
          tables[t.name] = t.type;
+         table_index_types[t.name] = t.index_type;
+      }
 
       for( const auto& e : abi.error_messages )
          error_messages[e.error_code] = e.error_msg;
@@ -135,6 +141,75 @@ namespace eosio { namespace chain {
       EOS_ASSERT( error_messages.size() == abi.error_messages.size(), duplicate_abi_err_msg_def_exception, "duplicate error message definition detected" );
 
       validate(deadline, max_serialization_time);
+      compile_types();
+   }
+
+   void abi_serializer::compile_types() {
+      for( const auto& st : structs )
+         compile_type(st.first);
+      for( const auto& td : typedefs )
+         compile_type(td.first);
+      for( const auto& a : actions )
+         compile_type(a.second);
+      for( const auto& t : tables )
+         compile_type(t.second);
+   }
+
+   uint32_t abi_serializer::compile_type(const type_name& type) {
+      auto itr = compiled_type_index.find(type);
+      if( itr != compiled_type_index.end() )
+         return itr->second;
+
+      type_name rtype = resolve_type(type);
+      if( rtype != type ) {
+         uint32_t index = compile_type(rtype);
+         compiled_type_index[type] = index;
+         return index;
+      }
+
+      // registered before compiling the parts, so recursive structs refer back to it
+      uint32_t index = compiled_types.size();
+      compiled_type_index[type] = index;
+      compiled_types.emplace_back();
+      compiled_types[index].name = type;
+
+      auto ftype = fundamental_type(type);
+      auto btype = built_in_types.find(ftype);
+      if( btype != built_in_types.end() ) {
+         auto& ct = compiled_types[index];
+         ct.kind = compiled_type::builtin;
+         ct.builtin_functions = btype->second;
+         ct.is_array = is_array(type);
+         ct.is_optional = is_optional(type);
+      } else if( is_array(type) || is_optional(type) ) {
+         uint32_t element = compile_type(ftype);
+         auto& ct = compiled_types[index];
+         ct.kind = is_array(type) ? compiled_type::array : compiled_type::optional;
+         ct.element = element;
+      } else {
+         const auto& st = get_struct(type);
+         vector<compiled_field> fields;
+         compile_fields(st, fields);
+         set<field_name> names;
+         bool shadowed = false;
+         for( const auto& f : fields )
+            shadowed |= !names.insert(f.name).second;
+         auto& ct = compiled_types[index];
+         ct.kind = compiled_type::structure;
+         ct.has_base = st.base != type_name();
+         ct.has_shadowed_fields = shadowed;
+         ct.fields = std::move(fields);
+      }
+      return index;
+   }
+
+   void abi_serializer::compile_fields(const struct_def& st, vector<compiled_field>& fields) {
+      if( st.base != type_name() )
+         compile_fields(get_struct(st.base), fields);
+      for( const auto& field : st.fields ) {
+         uint32_t type = compile_type(field.type);
+         fields.push_back(compiled_field{field.name, fc::json::to_string(field.name) + ':', type});
+      }
    }
 
    bool abi_serializer::is_builtin_type(const type_name& type)const {
@@ -263,9 +338,121 @@ namespace eosio { namespace chain {
       }
    }
 
+   fc::variant abi_serializer::_binary_to_variant( uint32_t type, fc::datastream<const char *>& stream,
+                                                   size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const
+   {
+      EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
+      EOS_ASSERT( fc::time_point::now() < deadline, abi_serialization_deadline_exception, "serialization time limit ${t}us exceeded", ("t", max_serialization_time) );
+      const auto& ct = compiled_types[type];
+      switch( ct.kind ) {
+         case compiled_type::builtin:
+            return ct.builtin_functions.first(stream, ct.is_array, ct.is_optional);
+         case compiled_type::array: {
+            fc::unsigned_int size;
+            fc::raw::unpack(stream, size);
+            vector<fc::variant> vars;
+            for( decltype(size.value) i = 0; i < size; ++i ) {
+               auto v = _binary_to_variant(ct.element, stream, recursion_depth, deadline, max_serialization_time);
+               EOS_ASSERT( !v.is_null(), unpack_exception, "Invalid packed array" );
+               vars.emplace_back(std::move(v));
+            }
+            return fc::variant( std::move(vars) );
+         }
+         case compiled_type::optional: {
+            char flag;
+            fc::raw::unpack(stream, flag);
+            return flag ? _binary_to_variant(ct.element, stream, recursion_depth, deadline, max_serialization_time) : fc::variant();
+         }
+         case compiled_type::structure:
+            break;
+      }
+
+      EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
+      fc::mutable_variant_object mvo;
+      for( const auto& field : ct.fields ) {
+         mvo( field.name, _binary_to_variant(field.type, stream, recursion_depth, deadline, max_serialization_time) );
+      }
+      EOS_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack stream ${type}", ("type", ct.name) );
+      return fc::variant( std::move(mvo) );
+   }
+
+   bool abi_serializer::_binary_to_json( uint32_t type, fc::datastream<const char *>& stream, string& out,
+                                         size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const
+   {
+      EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
+      EOS_ASSERT( fc::time_point::now() < deadline, abi_serialization_deadline_exception, "serialization time limit ${t}us exceeded", ("t", max_serialization_time) );
+      const auto& ct = compiled_types[type];
+      switch( ct.kind ) {
+         case compiled_type::builtin: {
+            // leaf values still go through their variant form, so they print exactly as fc::json does
+            auto v = ct.builtin_functions.first(stream, ct.is_array, ct.is_optional);
+            out += fc::json::to_string(v);
+            return !v.is_null();
+         }
+         case compiled_type::array: {
+            fc::unsigned_int size;
+            fc::raw::unpack(stream, size);
+            out += '[';
+            for( decltype(size.value) i = 0; i < size; ++i ) {
+               if( i > 0 )
+                  out += ',';
+               bool valid = _binary_to_json(ct.element, stream, out, recursion_depth, deadline, max_serialization_time);
+               EOS_ASSERT( valid, unpack_exception, "Invalid packed array" );
+            }
+            out += ']';
+            return true;
+         }
+         case compiled_type::optional: {
+            char flag;
+            fc::raw::unpack(stream, flag);
+            if( flag )
+               return _binary_to_json(ct.element, stream, out, recursion_depth, deadline, max_serialization_time);
+            out += "null";
+            return false;
+         }
+         case compiled_type::structure:
+            break;
+      }
+
+      if( ct.has_shadowed_fields ) {
+         // written through the variant, which keeps a shadowed key once at its first position with the last value
+         out += fc::json::to_string( _binary_to_variant(type, stream, recursion_depth, deadline, max_serialization_time) );
+         return true;
+      }
+
+      EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
+      EOS_ASSERT( ct.fields.size() > 0, unpack_exception, "Unable to unpack stream ${type}", ("type", ct.name) );
+      out += '{';
+      bool first = true;
+      for( const auto& field : ct.fields ) {
+         if( !first )
+            out += ',';
+         first = false;
+         out += field.json_key;
+         _binary_to_json(field.type, stream, out, recursion_depth, deadline, max_serialization_time);
+      }
+      out += '}';
+      return true;
+   }
+
+   void abi_serializer::_binary_to_json( const type_name& type, fc::datastream<const char *>& stream, string& out,
+                                         size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const
+   {
+      auto compiled = compiled_type_index.find(type);
+      if( compiled != compiled_type_index.end() ) {
+         _binary_to_json(compiled->second, stream, out, recursion_depth, deadline, max_serialization_time);
+         return;
+      }
+      out += fc::json::to_string( _binary_to_variant(type, stream, recursion_depth, deadline, max_serialization_time) );
+   }
+
    fc::variant abi_serializer::_binary_to_variant( const type_name& type, fc::datastream<const char *>& stream,
                                                    size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const
    {
+      auto compiled = compiled_type_index.find(type);
+      if( compiled != compiled_type_index.end() )
+         return _binary_to_variant(compiled->second, stream, recursion_depth, deadline, max_serialization_time);
+
       EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
       EOS_ASSERT( fc::time_point::now() < deadline, abi_serialization_deadline_exception, "serialization time limit ${t}us exceeded", ("t", max_serialization_time) );
       type_name rtype = resolve_type(type);
@@ -309,9 +496,67 @@ namespace eosio { namespace chain {
       return _binary_to_variant(type, ds, recursion_depth, deadline, max_serialization_time);
    }
 
+   void abi_serializer::_variant_to_binary( uint32_t type, const fc::variant& var, fc::datastream<char *>& ds,
+                                            size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const
+   { try {
+      EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
+      EOS_ASSERT( fc::time_point::now() < deadline, abi_serialization_deadline_exception, "serialization time limit ${t}us exceeded", ("t", max_serialization_time) );
+      const auto& ct = compiled_types[type];
+      switch( ct.kind ) {
+         case compiled_type::builtin:
+            ct.builtin_functions.second(var, ds, ct.is_array, ct.is_optional);
+            return;
+         case compiled_type::array: {
+            const auto& vars = var.get_array();
+            fc::raw::pack(ds, (fc::unsigned_int)vars.size());
+            for( const auto& v : vars ) {
+               _variant_to_binary(ct.element, v, ds, recursion_depth, deadline, max_serialization_time);
+            }
+            return;
+         }
+         case compiled_type::optional:
+            // optional structs are not supported for packing yet
+            EOS_THROW( invalid_type_inside_abi, "Unknown struct ${type}", ("type",ct.name) );
+         case compiled_type::structure:
+            break;
+      }
+
+      if( var.is_object() ) {
+         const auto& vo = var.get_object();
+         for( const auto& field : ct.fields ) {
+            auto itr = vo.find( field.name );
+            if( itr != vo.end() ) {
+               _variant_to_binary(field.type, itr->value(), ds, recursion_depth, deadline, max_serialization_time);
+            }
+            else {
+               _variant_to_binary(field.type, fc::variant(), ds, recursion_depth, deadline, max_serialization_time);
+               /// TODO: default construct field and write it out
+               EOS_THROW( pack_exception, "Missing '${f}' in variant object", ("f",field.name) );
+            }
+         }
+      } else if( var.is_array() ) {
+         const auto& va = var.get_array();
+         EOS_ASSERT( !ct.has_base, invalid_type_inside_abi, "support for base class as array not yet implemented" );
+         uint32_t i = 0;
+         if (va.size() > 0) {
+            for( const auto& field : ct.fields ) {
+               if( va.size() > i )
+                  _variant_to_binary(field.type, va[i], ds, recursion_depth, deadline, max_serialization_time);
+               else
+                  _variant_to_binary(field.type, fc::variant(), ds, recursion_depth, deadline, max_serialization_time);
+               ++i;
+            }
+         }
+      }
+   } FC_CAPTURE_AND_RETHROW( (compiled_types[type].name)(var) ) }
+
    void abi_serializer::_variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char *>& ds,
                                             size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const
    { try {
+      auto compiled = compiled_type_index.find(type);
+      if( compiled != compiled_type_index.end() )
+         return _variant_to_binary(compiled->second, var, ds, recursion_depth, deadline, max_serialization_time);
+
       EOS_ASSERT( ++recursion_depth < max_recursion_depth, abi_recursion_depth_exception, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth) );
       EOS_ASSERT( fc::time_point::now() < deadline, abi_serialization_deadline_exception, "serialization time limit ${t}us exceeded", ("t", max_serialization_time) );
       auto rtype = resolve_type(type);
@@ -388,6 +633,12 @@ namespace eosio { namespace chain {
       return type_name();
    }
 
+   type_name abi_serializer::get_table_index_type(name table)const {
+      auto itr = table_index_types.find(table);
+      if( itr != table_index_types.end() ) return itr->second;
+      return type_name();
+   }
+
    optional<string> abi_serializer::get_error_message( uint64_t error_code )const {
       auto itr = error_messages.find( error_code );
       if( itr == error_messages.end() )
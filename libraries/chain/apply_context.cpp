@@ -77,7 +77,8 @@ action_trace apply_context::exec_one()
    action_trace t(r);
    t.trx_id = trx_context.id;
    t.act = act;
-   t.console = _pending_console_output.str();
+   if( control.contracts_console() )
+      t.console = _pending_console_output.str();
 
    trx_context.executed.emplace_back( move(r) );
 
@@ -93,24 +94,25 @@ action_trace apply_context::exec_one()
 
 void apply_context::exec()
 {
-   _notified.push_back(receiver);
+   _buffers.notified.push_back(receiver);
    trace = exec_one();
-   for( uint32_t i = 1; i < _notified.size(); ++i ) {
-      receiver = _notified[i];
+   for( uint32_t i = 1; i < _buffers.notified.size(); ++i ) {
+      receiver = _buffers.notified[i];
       trace.inline_traces.emplace_back( exec_one() );
    }
 
-   if( _cfa_inline_actions.size() > 0 || _inline_actions.size() > 0 ) {
+   if( _buffers.cfa_inline_actions.size() > 0 || _buffers.inline_actions.size() > 0 ) {
       EOS_ASSERT( recurse_depth < control.get_global_properties().configuration.max_inline_action_depth,
                   transaction_exception, "inline action recursion depth reached" );
+      trace.inline_traces.reserve( trace.inline_traces.size() + _buffers.cfa_inline_actions.size() + _buffers.inline_actions.size() );
    }
 
-   for( const auto& inline_action : _cfa_inline_actions ) {
+   for( const auto& inline_action : _buffers.cfa_inline_actions ) {
       trace.inline_traces.emplace_back();
       trx_context.dispatch_action( trace.inline_traces.back(), inline_action, inline_action.account, true, recurse_depth + 1 );
    }
 
-   for( const auto& inline_action : _inline_actions ) {
+   for( const auto& inline_action : _buffers.inline_actions ) {
       trace.inline_traces.emplace_back();
       trx_context.dispatch_action( trace.inline_traces.back(), inline_action, inline_action.account, false, recurse_depth + 1 );
    }
@@ -152,7 +154,7 @@ void apply_context::require_authorization(const account_name& account,
 }
 
 bool apply_context::has_recipient( account_name code )const {
-   for( auto a : _notified )
+   for( auto a : _buffers.notified )
       if( a == code )
          return true;
    return false;
@@ -160,7 +162,7 @@ bool apply_context::has_recipient( account_name code )const {
 
 void apply_context::require_recipient( account_name recipient ) {
    if( !has_recipient(recipient) ) {
-      _notified.push_back(recipient);
+      _buffers.notified.push_back(recipient);
    }
 }
 
@@ -210,7 +212,7 @@ void apply_context::execute_inline( action&& a ) {
       //          action was made at the moment the deferred transaction was executed with potentially no forewarning?
    }
 
-   _inline_actions.emplace_back( move(a) );
+   _buffers.inline_actions.emplace_back( move(a) );
 }
 
 void apply_context::execute_context_free_inline( action&& a ) {
@@ -221,7 +223,7 @@ void apply_context::execute_context_free_inline( action&& a ) {
    EOS_ASSERT( a.authorization.size() == 0, action_validate_exception,
                "context-free actions cannot have authorizations" );
 
-   _cfa_inline_actions.emplace_back( move(a) );
+   _buffers.cfa_inline_actions.emplace_back( move(a) );
 }
 
 
@@ -350,8 +352,15 @@ vector<account_name> apply_context::get_active_producers() const {
 }
 
 void apply_context::reset_console() {
-   _pending_console_output = std::ostringstream();
+   // console_api drops all output when the console is off, so there is nothing to clear
+   if( !control.contracts_console() )
+      return;
+   _pending_console_output.str( std::string() );
+   _pending_console_output.clear();
+   _pending_console_output.flags( std::ios::dec | std::ios::skipws );
    _pending_console_output.setf( std::ios::scientific, std::ios::floatfield );
+   _pending_console_output.precision( 6 );
+   _pending_console_output.width( 0 );
 }
 
 bytes apply_context::get_packed_transaction() {
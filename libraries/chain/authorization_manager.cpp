@@ -12,22 +12,66 @@
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/contract_types.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
+#include <eosio/chain/database_utils.hpp>
+#include <eosio/chain/snapshot.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+EOSIO_SNAPSHOT_SECTION( eosio::chain::permission_usage_object, "eosio::chain::permission_usage_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::permission_object,       "eosio::chain::permission_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::permission_link_object,  "eosio::chain::permission_link_object" )
 
 namespace eosio { namespace chain {
 
+   namespace {
+      // the caches are dropped when they grow past these, rather than tracking use of each entry
+      const size_t max_cached_linked_permissions = 64*1024;
+      const size_t max_cached_authorizations     = 64*1024;
+   }
+
    authorization_manager::authorization_manager(controller& c, database& d)
    :_control(c),_db(d){}
 
+   using authorization_index_set = index_set<
+      permission_usage_index,
+      permission_index,
+      permission_link_index
+   >;
+
    void authorization_manager::add_indices() {
-      _db.add_index<permission_index>();
-      _db.add_index<permission_usage_index>();
-      _db.add_index<permission_link_index>();
+      authorization_index_set::add_indices(_db);
    }
 
    void authorization_manager::initialize_database() {
       _db.create<permission_object>([](auto&){}); /// reserve perm 0 (used else where)
    }
 
+   void authorization_manager::add_to_snapshot( snapshot_writer& snapshot )const {
+      authorization_index_set::walk_indices([this, &snapshot]( auto utils ){
+         add_index_to_snapshot<typename decltype(utils)::index_t>( snapshot, _db );
+      });
+   }
+
+   void authorization_manager::read_from_snapshot( snapshot_reader& snapshot ) {
+      invalidate_cache();
+
+      snapshot_id_map<permission_usage_object::id_type> usage_ids;
+      read_index_from_snapshot<permission_usage_index>( snapshot, _db, [&]( const auto& row, auto old_id ) {
+         usage_ids.add( old_id, row.id );
+      });
+
+      // a parent permission is always created before its children, so it has already been remapped
+      snapshot_id_map<permission_id_type> permission_ids;
+      read_index_from_snapshot<permission_index>( snapshot, _db, [&]( auto& row, auto old_id ) {
+         permission_ids.add( old_id, row.id );
+         row.usage_id = usage_ids( row.usage_id );
+         row.parent   = permission_ids( row.parent );
+      });
+
+      read_index_from_snapshot<permission_link_index>( snapshot, _db );
+   }
+
    const permission_object& authorization_manager::create_permission( account_name account,
                                                                       permission_name name,
                                                                       permission_id_type parent,
@@ -67,6 +111,8 @@ namespace eosio { namespace chain {
          creation_time = _control.pending_block_time();
       }
 
+      invalidate_cache();
+
       const auto& perm_usage = _db.create<permission_usage_object>([&](auto& p) {
          p.last_used = creation_time;
       });
@@ -83,6 +129,7 @@ namespace eosio { namespace chain {
    }
 
    void authorization_manager::modify_permission( const permission_object& permission, const authority& auth ) {
+      invalidate_cache();
       _db.modify( permission, [&](permission_object& po) {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
@@ -95,6 +142,7 @@ namespace eosio { namespace chain {
       EOS_ASSERT( range.first == range.second, action_validate_exception,
                   "Cannot remove a permission which has children. Remove the children first.");
 
+      invalidate_cache();
       _db.get_mutable_index<permission_usage_index>().remove_object( permission.usage_id._id );
       _db.remove( permission );
    }
@@ -128,6 +176,14 @@ namespace eosio { namespace chain {
                                                                             )const
    {
       try {
+         const auto cache_key = std::make_tuple(authorizer_account, scope, act_name);
+         if( !_cache_suspended ) {
+            auto itr = _linked_permission_cache.find( cache_key );
+            if( itr != _linked_permission_cache.end() )
+               return itr->second;
+         }
+
+         optional<permission_name> result;
          // First look up a specific link for this message act_name
          auto key = boost::make_tuple(authorizer_account, scope, act_name);
          auto link = _db.find<permission_link_object, by_action_name>(key);
@@ -139,11 +195,15 @@ namespace eosio { namespace chain {
 
          // If no specific or default link found, use active permission
          if (link != nullptr) {
-            return link->required_permission;
+            result = link->required_permission;
          }
-         return optional<permission_name>();
 
-       //  return optional<permission_name>();
+         if( !_cache_suspended ) {
+            if( _linked_permission_cache.size() >= max_cached_linked_permissions )
+               _linked_permission_cache.clear();
+            _linked_permission_cache.emplace( cache_key, result );
+         }
+         return result;
       } FC_CAPTURE_AND_RETHROW((authorizer_account)(scope)(act_name))
    }
 
@@ -335,13 +395,33 @@ namespace eosio { namespace chain {
 
       auto effective_provided_delay =  (provided_delay >= delay_max_limit) ? fc::microseconds::maximum() : provided_delay;
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
-                                        _control.get_global_properties().configuration.max_authority_depth,
-                                        provided_keys,
-                                        provided_permissions,
-                                        effective_provided_delay,
-                                        checktime
-                                      );
+      const auto max_authority_depth = _control.get_global_properties().configuration.max_authority_depth;
+      auto make_checker = [&]() {
+         return make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+                                   max_authority_depth,
+                                   provided_keys,
+                                   provided_permissions,
+                                   effective_provided_delay,
+                                   checktime
+                                 );
+      };
+
+      // each permission is checked on its own below, so with no provided permissions the outcome, and the keys
+      // it uses, depend only on the permission, the delay and the keys, and can be cached across transactions
+      const bool use_cache = !_cache_suspended && provided_permissions.empty();
+      // the entry of provided_keys is only created when a result is stored, a check that throws before that
+      // leaves nothing behind that _authorization_cache_size does not count
+      auto cached_results = _authorization_cache.end();
+      flat_set<public_key_type> used_keys;
+      if( use_cache ) {
+         if( _authorization_cache_depth != max_authority_depth || _authorization_cache_size >= max_cached_authorizations ) {
+            _authorization_cache.clear();
+            _authorization_cache_size = 0;
+            _authorization_cache_depth = max_authority_depth;
+         }
+         cached_results = _authorization_cache.find( provided_keys );
+      }
+      auto checker = make_checker();
 
       map<permission_level, fc::microseconds> permissions_to_satisfy;
 
@@ -399,7 +479,32 @@ namespace eosio { namespace chain {
       // ascending order of the actor name with ties broken by ascending order of the permission name.
       for( const auto& p : permissions_to_satisfy ) {
          checktime(); // TODO: this should eventually move into authority_checker instead
-         EOS_ASSERT( checker.satisfied( p.first, p.second ), unsatisfied_authorization,
+         bool satisfied = false;
+         if( use_cache ) {
+            const authorization_result* cached = nullptr;
+            if( cached_results != _authorization_cache.end() ) {
+               auto itr = cached_results->second.find( p );
+               if( itr != cached_results->second.end() )
+                  cached = &itr->second;
+            }
+            if( !cached ) {
+               auto permission_checker = make_checker();
+               authorization_result result;
+               result.satisfied = permission_checker.satisfied( p.first, p.second );
+               if( result.satisfied )
+                  result.used_keys = permission_checker.used_keys();
+               if( cached_results == _authorization_cache.end() )
+                  cached_results = _authorization_cache.emplace( provided_keys, std::map<authorization_key, authorization_result>() ).first;
+               cached = &cached_results->second.emplace( p, std::move(result) ).first->second;
+               ++_authorization_cache_size;
+            }
+            satisfied = cached->satisfied;
+            if( satisfied )
+               used_keys.insert( cached->used_keys.begin(), cached->used_keys.end() );
+         } else {
+            satisfied = checker.satisfied( p.first, p.second );
+         }
+         EOS_ASSERT( satisfied, unsatisfied_authorization,
                      "transaction declares authority '${auth}', "
                      "but does not have signatures for it under a provided delay of ${provided_delay} ms, "
                      "provided permissions ${provided_permissions}, and provided keys ${provided_keys}",
@@ -413,12 +518,33 @@ namespace eosio { namespace chain {
       }
 
       if( !allow_unused_keys ) {
-         EOS_ASSERT( checker.all_keys_used(), tx_irrelevant_sig,
-                     "transaction bears irrelevant signatures from these keys: ${keys}",
-                     ("keys", checker.unused_keys()) );
+         if( use_cache ) {
+            if( used_keys.size() != provided_keys.size() ) {
+               flat_set<public_key_type> unused_keys;
+               std::set_difference( provided_keys.begin(), provided_keys.end(), used_keys.begin(), used_keys.end(),
+                                    std::inserter( unused_keys, unused_keys.end() ) );
+               EOS_THROW( tx_irrelevant_sig, "transaction bears irrelevant signatures from these keys: ${keys}",
+                          ("keys", unused_keys) );
+            }
+         } else {
+            EOS_ASSERT( checker.all_keys_used(), tx_irrelevant_sig,
+                        "transaction bears irrelevant signatures from these keys: ${keys}",
+                        ("keys", checker.unused_keys()) );
+         }
       }
    }
 
+   void authorization_manager::invalidate_cache() {
+      _linked_permission_cache.clear();
+      _authorization_cache.clear();
+      _authorization_cache_size = 0;
+      _cache_suspended = true;
+   }
+
+   void authorization_manager::resume_cache() {
+      _cache_suspended = false;
+   }
+
    void
    authorization_manager::check_authorization( account_name                         account,
                                                permission_name                      permission,
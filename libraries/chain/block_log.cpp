@@ -4,17 +4,140 @@
  */
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <fc/io/raw.hpp>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
 namespace eosio { namespace chain {
 
-   const uint32_t block_log::supported_version = 1;
+   namespace bip = boost::interprocess;
+   namespace bmi = boost::multi_index;
+
+   const uint32_t block_log::min_supported_version = 1;
+
+   /**
+    * History:
+    * Version 1: complete block log from genesis
+    * Version 2: adds optional partial block log, the first block number is written after the version
+    *            so that a log can be started from a snapshot
+    */
+   const uint32_t block_log::supported_version = 2;
+
+   namespace {
+      /// reads the first block number of the log, version 1 logs always start at block 1
+      template<typename Stream>
+      uint32_t read_first_block_num( Stream& stream, uint32_t version ) {
+         uint32_t first_block_num = 1;
+         if( version > 1 ) {
+            stream.read( (char*)&first_block_num, sizeof(first_block_num) );
+         }
+         return first_block_num;
+      }
+
+      void check_version( uint32_t version ) {
+         EOS_ASSERT( version > 0, block_log_exception, "Block log was not setup properly with genesis information." );
+         EOS_ASSERT( version >= block_log::min_supported_version && version <= block_log::supported_version, block_log_unsupported_version,
+                    "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
+                    ("version", version)("min", block_log::min_supported_version)("max", block_log::supported_version) );
+      }
+   }
 
    namespace detail {
+      /**
+       * Read only mapping of one of the block log files. The files are only ever appended to, so the
+       * mapping stays valid and only has to be extended once the writer has flushed past its end.
+       *
+       * The mapping is made larger than the file, doubling each time it is outgrown, so appends are
+       * remapped a logarithmic number of times. Pages past the end of the file must not be touched;
+       * callers only read below the flushed size, and a shared mapping sees the bytes appended to the
+       * file after it was made.
+       *
+       * The region is reference counted, so a reader that took it under the lock can keep reading from
+       * it after a later remap replaced it.
+       */
+      class mapped_log_file {
+         public:
+            static constexpr uint64_t min_mapped_size = 64*1024*1024;
+
+            void open( const fc::path& file ) {
+               close();
+               path = file;
+            }
+
+            void close() {
+               region.reset();
+               mapped_size = 0;
+            }
+
+            /// makes sure the first `length` bytes of the file are mapped
+            void ensure( uint64_t length ) {
+               if( length <= mapped_size )
+                  return;
+               uint64_t new_size = std::max( length, std::max( mapped_size * 2, min_mapped_size ) );
+               bip::file_mapping mapping( path.generic_string().c_str(), bip::read_only );
+               region = std::make_shared<const bip::mapped_region>( mapping, bip::read_only, 0, new_size );
+               mapped_size = new_size;
+            }
+
+            const char* data()const { return static_cast<const char*>( region->get_address() ); }
+
+            const std::shared_ptr<const bip::mapped_region>& get_region()const { return region; }
+
+         private:
+            fc::path                                   path;
+            std::shared_ptr<const bip::mapped_region>  region;
+            uint64_t                                   mapped_size = 0;
+      };
+
+      constexpr uint64_t mapped_log_file::min_mapped_size;
+
+      /// the bytes of a block from `pos` to the flushed end of the log, with the mapping that holds them
+      struct mapped_block {
+         std::shared_ptr<const bip::mapped_region>  region;
+         const char*                                data = nullptr;
+         uint64_t                                   size = 0;
+         uint64_t                                   pos  = 0;
+      };
+
+      /// cached blocks are never handed out, callers get their own copy which they are free to modify
+      struct cached_block {
+         uint32_t                             block_num;
+         std::shared_ptr<const signed_block>  block;
+      };
+
+      struct by_block_num;
+      typedef bmi::multi_index_container<
+         cached_block,
+         bmi::indexed_by<
+            bmi::sequenced<>,
+            bmi::hashed_unique< bmi::tag<by_block_num>, bmi::member<cached_block, uint32_t, &cached_block::block_num> >
+         >
+      > block_cache_index;
+
+      /**
+       * The write handles are opened append only and are never repositioned, reads go through read only
+       * mappings of the same files. block_file_size and index_file_size only count bytes that have been
+       * flushed, so everything below them is complete and safe to map.
+       *
+       * Recently read or appended blocks are kept in a small LRU cache, so peers syncing near the head
+       * and repeated lookups of the same block do not deserialize it again.
+       *
+       * read_mutex only guards the index, the cache and the mappings; blocks are deserialized and copied
+       * after it is released, so concurrent readers do not wait on each other.
+       */
       class block_log_impl {
          public:
             signed_block_ptr         head;
@@ -23,51 +146,99 @@ namespace eosio { namespace chain {
             std::fstream             index_stream;
             fc::path                 block_file;
             fc::path                 index_file;
-            bool                     block_write;
-            bool                     index_write;
+            uint64_t                 block_file_size = 0;
+            uint64_t                 index_file_size = 0;
             bool                     genesis_written_to_block_log = false;
+            uint32_t                 first_block_num = 1;
 
-            inline void check_block_read() {
-               if (block_write) {
-                  block_stream.close();
-                  block_stream.open(block_file.generic_string().c_str(), LOG_READ);
-                  block_write = false;
-               }
+            std::mutex               read_mutex; ///< guards the mappings, the cache and the file sizes
+            mapped_log_file          block_map;
+            mapped_log_file          index_map;
+            block_cache_index        block_cache;
+            uint32_t                 block_cache_size = 0;
+
+            void open_write_streams() {
+               block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
+               index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
             }
 
-            inline void check_block_write() {
-               if (!block_write) {
+            void close_streams() {
+               if (block_stream.is_open())
                   block_stream.close();
-                  block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
-                  block_write = true;
-               }
+               if (index_stream.is_open())
+                  index_stream.close();
+               block_map.close();
+               index_map.close();
+               block_cache.clear();
             }
 
-            inline void check_index_read() {
-               try {
-                  if (index_write) {
-                     index_stream.close();
-                     index_stream.open(index_file.generic_string().c_str(), LOG_READ);
-                     index_write = false;
-                  }
-               }
-               FC_LOG_AND_RETHROW()
+            /// reads the position stored in the last 8 bytes of a mapped file
+            static uint64_t read_last_pos( mapped_log_file& file, uint64_t file_size ) {
+               file.ensure( file_size );
+               uint64_t pos;
+               memcpy( &pos, file.data() + file_size - sizeof(pos), sizeof(pos) );
+               return pos;
             }
 
-            inline void check_index_write() {
-               if (!index_write) {
-                  index_stream.close();
-                  index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
-                  index_write = true;
+            /// must be called with read_mutex held, the result can be unpacked after releasing it
+            mapped_block map_block( uint64_t pos ) {
+               EOS_ASSERT( pos < block_file_size, block_log_exception,
+                           "Block position ${pos} is past the end of the block log", ("pos", pos)("size", block_file_size) );
+               block_map.ensure( block_file_size );
+               return mapped_block{ block_map.get_region(), block_map.data() + pos, block_file_size - pos, pos };
+            }
+
+            static std::pair<signed_block_ptr, uint64_t> unpack_block( const mapped_block& m ) {
+               fc::datastream<const char*> ds( m.data, m.size );
+               std::pair<signed_block_ptr,uint64_t> result;
+               result.first = std::make_shared<signed_block>();
+               fc::raw::unpack( ds, *result.first );
+               result.second = m.pos + ds.tellp() + sizeof(uint64_t);
+               return result;
+            }
+
+            uint64_t get_block_pos( uint32_t block_num ) {
+               if (!(head && block_num <= block_header::num_from_id(head_id) && block_num >= first_block_num))
+                  return block_log::npos;
+
+               uint64_t offset = sizeof(uint64_t) * (block_num - first_block_num);
+               EOS_ASSERT( offset + sizeof(uint64_t) <= index_file_size, block_log_exception,
+                           "Block index is missing block ${num}", ("num", block_num) );
+               index_map.ensure( index_file_size );
+
+               uint64_t pos;
+               memcpy( &pos, index_map.data() + offset, sizeof(pos) );
+               return pos;
+            }
+
+            std::shared_ptr<const signed_block> find_cached( uint32_t block_num ) {
+               auto& by_num = block_cache.get<by_block_num>();
+               auto itr = by_num.find( block_num );
+               if( itr == by_num.end() )
+                  return {};
+               block_cache.relocate( block_cache.begin(), block_cache.project<0>( itr ) );
+               return itr->block;
+            }
+
+            void add_cached( uint32_t block_num, std::shared_ptr<const signed_block> b ) {
+               if( block_cache_size == 0 )
+                  return;
+               auto res = block_cache.push_front( cached_block{ block_num, std::move(b) } );
+               if( !res.second ) {
+                  block_cache.relocate( block_cache.begin(), res.first );
+                  return;
                }
+               while( block_cache.size() > block_cache_size )
+                  block_cache.pop_back();
             }
       };
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, uint32_t cache_size)
    :my(new detail::block_log_impl()) {
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->block_cache_size = cache_size;
       open(data_dir);
    }
 
@@ -83,10 +254,7 @@ namespace eosio { namespace chain {
    }
 
    void block_log::open(const fc::path& data_dir) {
-      if (my->block_stream.is_open())
-         my->block_stream.close();
-      if (my->index_stream.is_open())
-         my->index_stream.close();
+      my->close_streams();
 
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
@@ -94,10 +262,9 @@ namespace eosio { namespace chain {
       my->index_file = data_dir / "blocks.index";
 
       //ilog("Opening block log at ${path}", ("path", my->block_file.generic_string()));
-      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
-      my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->block_write = true;
-      my->index_write = true;
+      my->open_write_streams();
+      my->block_map.open(my->block_file);
+      my->index_map.open(my->index_file);
 
       /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to each other.
@@ -119,34 +286,27 @@ namespace eosio { namespace chain {
        */
       auto log_size = fc::file_size(my->block_file);
       auto index_size = fc::file_size(my->index_file);
+      my->block_file_size = log_size;
+      my->index_file_size = index_size;
 
       if (log_size) {
          ilog("Log is nonempty");
-         my->check_block_read();
-         my->block_stream.seekg( 0 );
+         EOS_ASSERT( log_size > sizeof(uint32_t), block_log_exception, "Block log is truncated" );
+         my->block_map.ensure( log_size );
+         fc::datastream<const char*> header( my->block_map.data(), log_size );
          uint32_t version = 0;
-         my->block_stream.read( (char*)&version, sizeof(version) );
-         EOS_ASSERT( version > 0, block_log_exception, "Block log was not setup properly with genesis information." );
-         EOS_ASSERT( version == block_log::supported_version, block_log_unsupported_version,
-                    "Unsupported version of block log. Block log version is ${version} while code supports version ${supported}",
-                    ("version", version)("supported", block_log::supported_version) );
+         header.read( (char*)&version, sizeof(version) );
+         check_version( version );
+         my->first_block_num = read_first_block_num( header, version );
 
          my->genesis_written_to_block_log = true; // Assume it was constructed properly.
          my->head = read_head();
          my->head_id = my->head->id();
 
          if (index_size) {
-            my->check_block_read();
-            my->check_index_read();
-
             ilog("Index is nonempty");
-            uint64_t block_pos;
-            my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->block_stream.read((char*)&block_pos, sizeof(block_pos));
-
-            uint64_t index_pos;
-            my->index_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->index_stream.read((char*)&index_pos, sizeof(index_pos));
+            uint64_t block_pos = detail::block_log_impl::read_last_pos( my->block_map, log_size );
+            uint64_t index_pos = detail::block_log_impl::read_last_pos( my->index_map, index_size );
 
             if (block_pos < index_pos) {
                ilog("block_pos < index_pos, close and reopen index_stream");
@@ -164,7 +324,7 @@ namespace eosio { namespace chain {
          my->index_stream.close();
          fc::remove_all(my->index_file);
          my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-         my->index_write = true;
+         my->index_file_size = 0;
       }
    }
 
@@ -172,24 +332,28 @@ namespace eosio { namespace chain {
       try {
          EOS_ASSERT( my->genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written" );
 
-         my->check_block_write();
-         my->check_index_write();
-
-         uint64_t pos = my->block_stream.tellp();
-         EOS_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - 1),
+         uint64_t pos = my->block_file_size;
+         EOS_ASSERT(my->index_file_size == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
                    block_log_append_fail,
                    "Append to index file occuring at wrong position.",
-                   ("position", (uint64_t) my->index_stream.tellp())
-                   ("expected", (b->block_num() - 1) * sizeof(uint64_t)));
+                   ("position", my->index_file_size)
+                   ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
          auto data = fc::raw::pack(*b);
          my->block_stream.write(data.data(), data.size());
          my->block_stream.write((char*)&pos, sizeof(pos));
          my->index_stream.write((char*)&pos, sizeof(pos));
-         my->head = b;
-         my->head_id = b->id();
 
          flush();
 
+         // the caller keeps and may modify b, the cache gets its own copy
+         auto cached = my->block_cache_size ? std::make_shared<const signed_block>( *b ) : std::shared_ptr<const signed_block>();
+         std::lock_guard<std::mutex> g( my->read_mutex );
+         my->block_file_size += data.size() + sizeof(pos);
+         my->index_file_size += sizeof(pos);
+         my->head = b;
+         my->head_id = b->id();
+         my->add_cached( b->block_num(), std::move(cached) );
+
          return pos;
       }
       FC_LOG_AND_RETHROW()
@@ -200,29 +364,30 @@ namespace eosio { namespace chain {
       my->index_stream.flush();
    }
 
-   uint64_t block_log::reset_to_genesis( const genesis_state& gs, const signed_block_ptr& genesis_block ) {
-      if( my->block_stream.is_open() )
-         my->block_stream.close();
-      if( my->index_stream.is_open() )
-         my->index_stream.close();
+   uint64_t block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block ) {
+      {
+         std::lock_guard<std::mutex> g( my->read_mutex );
+         my->close_streams();
+         my->head.reset();
+         my->head_id = block_id_type();
+      }
 
       fc::remove_all( my->block_file );
       fc::remove_all( my->index_file );
 
-      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
-      my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->block_write = true;
-      my->index_write = true;
+      my->open_write_streams();
 
       auto data = fc::raw::pack( gs );
       uint32_t version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
+      my->first_block_num = first_block->block_num();
       my->block_stream.write( (char*)&version, sizeof(version) );
+      my->block_stream.write( (char*)&my->first_block_num, sizeof(my->first_block_num) );
       my->block_stream.write( data.data(), data.size() );
+      my->block_file_size = sizeof(version) + sizeof(my->first_block_num) + data.size();
+      my->index_file_size = 0;
       my->genesis_written_to_block_log = true;
 
-      auto ret = append( genesis_block );
-
-      auto pos = my->block_stream.tellp();
+      auto ret = append( first_block );
 
       my->block_stream.close();
       my->block_stream.open(my->block_file.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary ); // Bypass append-only writing just once
@@ -231,94 +396,104 @@ namespace eosio { namespace chain {
       version = block_log::supported_version;
       my->block_stream.seekp( 0 );
       my->block_stream.write( (char*)&version, sizeof(version) ); // Finally write actual version to disk.
-      my->block_stream.seekp( pos );
-      flush();
+      my->block_stream.flush();
 
-      my->block_write = false;
-      my->check_block_write(); // Reset to append-only writing.
+      my->block_stream.close();
+      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE); // Reset to append-only writing.
 
       return ret;
    }
 
    std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
-      my->check_block_read();
-
-      my->block_stream.seekg(pos);
-      std::pair<signed_block_ptr,uint64_t> result;
-      result.first = std::make_shared<signed_block>();
-      fc::raw::unpack(my->block_stream, *result.first);
-      result.second = uint64_t(my->block_stream.tellg()) + 8;
-      return result;
+      detail::mapped_block m;
+      {
+         std::lock_guard<std::mutex> g( my->read_mutex );
+         m = my->map_block( pos );
+      }
+      return detail::block_log_impl::unpack_block( m );
    }
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
-         signed_block_ptr b;
-         uint64_t pos = get_block_pos(block_num);
-         if (pos != npos) {
-            b = read_block(pos).first;
-            EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
-                      "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
+         detail::mapped_block m;
+         {
+            std::lock_guard<std::mutex> g( my->read_mutex );
+            if( auto cached = my->find_cached( block_num ) )
+               return std::make_shared<signed_block>( *cached );
+
+            uint64_t pos = my->get_block_pos(block_num);
+            if (pos == npos)
+               return {};
+            m = my->map_block( pos );
+         }
+
+         signed_block_ptr b = detail::block_log_impl::unpack_block( m ).first;
+         EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
+                   "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
+         if( my->block_cache_size ) {
+            auto cached = std::make_shared<const signed_block>( *b );
+            std::lock_guard<std::mutex> g( my->read_mutex );
+            my->add_cached( block_num, std::move(cached) );
          }
          return b;
       } FC_LOG_AND_RETHROW()
    }
 
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
-      my->check_index_read();
-
-      if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num > 0))
-         return npos;
-      my->index_stream.seekg(sizeof(uint64_t) * (block_num - 1));
-      uint64_t pos;
-      my->index_stream.read((char*)&pos, sizeof(pos));
-      return pos;
+      std::lock_guard<std::mutex> g( my->read_mutex );
+      return my->get_block_pos( block_num );
    }
 
    signed_block_ptr block_log::read_head()const {
-      my->check_block_read();
-
-      uint64_t pos;
+      detail::mapped_block m;
+      {
+         std::lock_guard<std::mutex> g( my->read_mutex );
 
-      // Check that the file is not empty
-      my->block_stream.seekg(0, std::ios::end);
-      if (my->block_stream.tellg() <= sizeof(pos))
-         return {};
+         // Check that the file is not empty
+         if (my->block_file_size <= sizeof(uint64_t))
+            return {};
 
-      my->block_stream.seekg(-sizeof(pos), std::ios::end);
-      my->block_stream.read((char*)&pos, sizeof(pos));
-      return read_block(pos).first;
+         uint64_t pos = detail::block_log_impl::read_last_pos( my->block_map, my->block_file_size );
+         m = my->map_block( pos );
+      }
+      return detail::block_log_impl::unpack_block( m ).first;
    }
 
    const signed_block_ptr& block_log::head()const {
       return my->head;
    }
 
+   uint32_t block_log::first_block_num()const {
+      return my->first_block_num;
+   }
+
    void block_log::construct_index() {
       ilog("Reconstructing Block Log Index...");
       my->index_stream.close();
+      my->index_map.close();
       fc::remove_all(my->index_file);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->index_write = true;
+      my->index_file_size = 0;
 
-      uint64_t end_pos;
-      my->check_block_read();
-
-      my->block_stream.seekg(-sizeof( uint64_t), std::ios::end);
-      my->block_stream.read((char*)&end_pos, sizeof(end_pos));
+      uint64_t end_pos = detail::block_log_impl::read_last_pos( my->block_map, my->block_file_size );
+      fc::datastream<const char*> ds( my->block_map.data(), my->block_file_size );
       signed_block tmp;
 
-      uint64_t pos = 4; // Skip version which should have already been checked.
-      my->block_stream.seekg(pos);
+      uint64_t pos = 0;
+      uint32_t version = 0; // version and first block number should have already been checked.
+      ds.read( (char*)&version, sizeof(version) );
+      read_first_block_num( ds, version );
 
       genesis_state gs;
-      fc::raw::unpack(my->block_stream, gs);
+      fc::raw::unpack(ds, gs);
 
       while( pos < end_pos ) {
-         fc::raw::unpack(my->block_stream, tmp);
-         my->block_stream.read((char*)&pos, sizeof(pos));
+         fc::raw::unpack(ds, tmp);
+         ds.read((char*)&pos, sizeof(pos));
          my->index_stream.write((char*)&pos, sizeof(pos));
+         my->index_file_size += sizeof(pos);
       }
+      my->index_stream.flush();
    } // construct_index
 
    /**
@@ -368,16 +543,17 @@ namespace eosio { namespace chain {
 
       uint32_t version = 0;
       old_block_stream.read( (char*)&version, sizeof(version) );
-      EOS_ASSERT( version > 0, block_log_exception, "Block log was not setup properly with genesis information." );
-      EOS_ASSERT( version == block_log::supported_version, block_log_unsupported_version,
-                 "Unsupported version of block log. Block log version is ${version} while code supports version ${supported}",
-                 ("version", version)("supported", block_log::supported_version) );
+      check_version( version );
+      uint32_t first_block_num = read_first_block_num( old_block_stream, version );
 
       genesis_state gs;
       fc::raw::unpack(old_block_stream, gs);
 
       auto data = fc::raw::pack( gs );
       new_block_stream.write( (char*)&version, sizeof(version) );
+      if( version > 1 ) {
+         new_block_stream.write( (char*)&first_block_num, sizeof(first_block_num) );
+      }
       new_block_stream.write( data.data(), data.size() );
 
       std::exception_ptr     except_ptr;
@@ -401,6 +577,9 @@ namespace eosio { namespace chain {
          }
 
          auto id = tmp.id();
+         if( block_num == 0 && first_block_num > 1 ) {
+            previous = tmp.previous; // a log started from a snapshot does not link back to genesis
+         }
          if( block_header::num_from_id(previous) + 1 != block_header::num_from_id(id) ) {
             elog( "Block ${num} (${id}) skips blocks. Previous block in block log is block ${prev_num} (${previous})",
                   ("num", block_header::num_from_id(id))("id", id)
@@ -479,10 +658,8 @@ namespace eosio { namespace chain {
 
       uint32_t version = 0;
       block_stream.read( (char*)&version, sizeof(version) );
-      EOS_ASSERT( version > 0, block_log_exception, "Block log was not setup properly with genesis information." );
-      EOS_ASSERT( version == block_log::supported_version, block_log_unsupported_version,
-                 "Unsupported version of block log. Block log version is ${version} while code supports version ${supported}",
-                 ("version", version)("supported", block_log::supported_version) );
+      check_version( version );
+      read_first_block_num( block_stream, version );
 
       genesis_state gs;
       fc::raw::unpack(block_stream, gs);
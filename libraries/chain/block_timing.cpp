@@ -0,0 +1,113 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/block_timing.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+namespace eosio { namespace chain {
+
+   constexpr uint32_t block_timing::default_window;
+   constexpr uint32_t block_timing::bucket_count;
+
+   const char* to_string( block_stage s ) {
+      switch( s ) {
+         case block_stage::start_block:                return "start_block";
+         case block_stage::onblock:                    return "onblock";
+         case block_stage::push_transaction:           return "push_transaction";
+         case block_stage::push_scheduled_transaction: return "push_scheduled_transaction";
+         case block_stage::finalize_block:             return "finalize_block";
+         case block_stage::update_resource_limits:     return "update_resource_limits";
+         case block_stage::set_action_merkle:          return "set_action_merkle";
+         case block_stage::set_trx_merkle:             return "set_trx_merkle";
+         case block_stage::sign_block:                 return "sign_block";
+         case block_stage::commit_block:               return "commit_block";
+         case block_stage::on_irreversible:            return "on_irreversible";
+         case block_stage::stage_count:                break;
+      }
+      return "unknown";
+   }
+
+   block_timing::block_timing( uint32_t window )
+   :_window( std::max<uint32_t>( window, 1 ) )
+   {
+   }
+
+   void block_timing::record( block_stage s, fc::microseconds elapsed ) {
+      auto us = elapsed.count();
+      std::lock_guard<std::mutex> g( _mutex );
+      auto& st = _stages[static_cast<size_t>(s)];
+      if( st.ring.size() < _window )
+         st.ring.push_back( us );
+      else
+         st.ring[st.count % _window] = us;
+      ++st.count;
+      st.total_us += us;
+      st.block_total_us += us;
+      ++st.block_count;
+   }
+
+   std::vector<block_stage_timing> block_timing::get_timings()const {
+      std::vector<block_stage_timing> result;
+      result.reserve( _stages.size() );
+
+      std::vector<int64_t> sorted;
+      for( size_t i = 0; i < _stages.size(); ++i ) {
+         block_stage_timing t;
+         t.stage = to_string( static_cast<block_stage>(i) );
+         t.buckets.resize( bucket_count );
+         {
+            std::lock_guard<std::mutex> g( _mutex );
+            t.count = _stages[i].count;
+            t.total_us = _stages[i].total_us;
+            sorted = _stages[i].ring;
+         }
+         t.window_count = sorted.size();
+
+         if( !sorted.empty() ) {
+            std::sort( sorted.begin(), sorted.end() );
+            auto percentile = [&]( uint32_t pct ) { return sorted[(sorted.size() - 1) * pct / 100]; };
+            int64_t total = 0;
+            for( auto us : sorted ) {
+               total += us;
+               uint32_t b = 0;
+               while( b + 1 < bucket_count && us >= (int64_t(1) << b) ) ++b;
+               ++t.buckets[b];
+            }
+            t.min_us = sorted.front();
+            t.max_us = sorted.back();
+            t.avg_us = total / int64_t(sorted.size());
+            t.p50_us = percentile( 50 );
+            t.p90_us = percentile( 90 );
+            t.p99_us = percentile( 99 );
+         }
+         result.emplace_back( std::move(t) );
+      }
+      return result;
+   }
+
+   void block_timing::reset_block() {
+      std::lock_guard<std::mutex> g( _mutex );
+      for( auto& st : _stages ) {
+         st.block_total_us = 0;
+         st.block_count = 0;
+      }
+   }
+
+   std::string block_timing::block_summary()const {
+      std::ostringstream out;
+      std::lock_guard<std::mutex> g( _mutex );
+      for( size_t i = 0; i < _stages.size(); ++i ) {
+         const auto& st = _stages[i];
+         if( st.block_count == 0 ) continue;
+         if( out.tellp() > 0 ) out << ", ";
+         out << to_string( static_cast<block_stage>(i) ) << ' ';
+         if( st.block_count > 1 ) out << st.block_count << "x ";
+         out << st.block_total_us << "us";
+      }
+      return out.str();
+   }
+
+} } // eosio::chain
@@ -10,21 +10,67 @@
 #include <eosio/chain/contract_table_objects.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/transaction_object.hpp>
+#include <eosio/chain/unapplied_transaction_queue.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
 
 #include <eosio/chain/authorization_manager.hpp>
 #include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/database_utils.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/block_timing.hpp>
 
 #include <chainbase/chainbase.hpp>
 #include <fc/io/json.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+
+#include <mutex>
+
 #include <eosio/chain/eosio_contract.hpp>
 
+EOSIO_SNAPSHOT_SECTION( eosio::chain::account_object,                 "eosio::chain::account_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::account_sequence_object,        "eosio::chain::account_sequence_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::global_property_object,         "eosio::chain::global_property_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::dynamic_global_property_object, "eosio::chain::dynamic_global_property_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::block_summary_object,           "eosio::chain::block_summary_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::transaction_object,             "eosio::chain::transaction_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::generated_transaction_object,   "eosio::chain::generated_transaction_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::table_id_object,                "eosio::chain::table_id_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::key_value_object,               "eosio::chain::key_value_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::index64_object,                 "eosio::chain::index64_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::index128_object,                "eosio::chain::index128_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::index256_object,                "eosio::chain::index256_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::index_double_object,            "eosio::chain::index_double_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::index_long_double_object,       "eosio::chain::index_long_double_object" )
+
 namespace eosio { namespace chain {
 
 using resource_limits::resource_limits_manager;
 
+using controller_index_set = index_set<
+   account_index,
+   account_sequence_index,
+   global_property_multi_index,
+   dynamic_global_property_multi_index,
+   block_summary_multi_index,
+   transaction_multi_index,
+   generated_transaction_multi_index
+>;
+
+/// rows of these indices belong to a table_id_object and refer to it by id
+using contract_database_index_set = index_set<
+   key_value_index,
+   index64_index,
+   index128_index,
+   index256_index,
+   index_double_index,
+   index_long_double_index
+>;
 
 struct pending_state {
    pending_state( database::session&& s )
@@ -69,7 +115,43 @@ struct controller_impl {
     *  are removed from this list if they are re-applied in other blocks. Producers
     *  can query this list when scheduling new transactions into blocks.
     */
-   map<digest_type, transaction_metadata_ptr>     unapplied_transactions;
+   unapplied_transaction_queue                    unapplied_transactions;
+
+   /**
+    *  Context free work for the input transactions of blocks that are about to be applied (unpacking,
+    *  id/signed_id computation and signature recovery) is started on the thread pool ahead of execution
+    *  and picked up by apply_block, keyed by block id. Only replay reads blocks ahead; a block pushed by
+    *  the network is prepared when apply_block starts, which overlaps the preparation of its own
+    *  transactions with each other but not with the previous block.
+    */
+   using trx_meta_futures = vector<std::future<transaction_metadata_ptr>>;
+   map<block_id_type, trx_meta_futures>          prevalidated_blocks;
+   boost::asio::thread_pool                      thread_pool;
+   deadline_timer                                timer; ///< shared by the transaction_contexts, which run one at a time
+   block_timing                                  timing;
+
+   /**
+    *  abi_serializers built by get_abi_serializer, one per account, tagged with the abi_sequence of the
+    *  ABI they were built from. The least recently used entries are dropped beyond
+    *  config::default_abi_serializer_cache_size accounts. Read only APIs may call in from other threads,
+    *  hence the mutex.
+    */
+   struct cached_abi_serializer {
+      account_name       account;
+      uint64_t           abi_sequence = 0;
+      abi_serializer_ptr serializer;
+   };
+   struct by_account;
+   typedef boost::multi_index_container<
+      cached_abi_serializer,
+      boost::multi_index::indexed_by<
+         boost::multi_index::sequenced<>, ///< most recently used first
+         boost::multi_index::ordered_unique< boost::multi_index::tag<by_account>,
+            boost::multi_index::member<cached_abi_serializer, account_name, &cached_abi_serializer::account> >
+      >
+   > abi_serializer_cache_index;
+   abi_serializer_cache_index                    abi_serializer_cache;
+   std::mutex                                    abi_serializer_cache_mutex;
 
    void pop_block() {
       auto prev = fork_db.get_block( head->header.previous );
@@ -82,10 +164,11 @@ struct controller_impl {
 
       if ( read_mode == db_read_mode::SPECULATIVE ) {
          for( const auto& t : head->trxs )
-            unapplied_transactions[t->signed_id] = t;
+            unapplied_transactions.add( t );
       }
       head = prev;
       db.undo();
+      authorization.invalidate_cache();
 
    }
 
@@ -104,12 +187,13 @@ struct controller_impl {
         cfg.reversible_cache_size ),
     blog( cfg.blocks_dir ),
     fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime ),
+    wasmif( cfg.wasm_runtime, cfg.state_dir/config::default_code_cache_dir_name, cfg.wasm_cache_limits ),
     resource_limits( db ),
     authorization( s, db ),
     conf( cfg ),
     chain_id( cfg.genesis.compute_chain_id() ),
-    read_mode( cfg.read_mode )
+    read_mode( cfg.read_mode ),
+    thread_pool( cfg.thread_pool_size )
    {
 
 #define SET_APP_HANDLER( receiver, contract, action) \
@@ -163,6 +247,8 @@ struct controller_impl {
    }
 
    void on_irreversible( const block_state_ptr& s ) {
+      block_timing::scoped irreversible_timer( timing, block_stage::on_irreversible );
+
       if( !blog.head() )
          blog.read_head();
 
@@ -198,47 +284,94 @@ struct controller_impl {
       emit( self.irreversible_block, s );
    }
 
-   void init() {
+   /**
+    *  Replays the blocks of the block log after head, up to end, followed by the reversible blocks.
+    */
+   void replay( const signed_block_ptr& end ) {
+      replaying = true;
+      ilog( "existing block log, attempting to replay ${n} blocks", ("n",end->block_num() - head->block_num) );
+
+      auto start = fc::time_point::now();
+      auto start_block_num = head->block_num;
+      // keep the transactions of the next few blocks being prepared on the thread pool while the
+      // current block executes
+      deque<signed_block_ptr> read_ahead;
+      uint32_t next_read = head->block_num + 1;
+      auto fill_read_ahead = [&]() {
+         while( read_ahead.size() < config::block_prevalidation_depth ) {
+            auto b = blog.read_block_by_num( next_read );
+            if( !b ) break;
+            ++next_read;
+            prevalidate_block( b );
+            read_ahead.emplace_back( std::move(b) );
+         }
+      };
+      fill_read_ahead();
+      while( !read_ahead.empty() ) {
+         auto next = read_ahead.front();
+         read_ahead.pop_front();
+         self.push_block( next, controller::block_status::irreversible );
+         fill_read_ahead();
+         if( next->block_num() % 100 == 0 ) {
+            std::cerr << std::setw(10) << next->block_num() << " of " << end->block_num() <<"\r";
+         }
+      }
+      prevalidated_blocks.clear();
+
+      int rev = 0;
+      while( auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1) ) {
+         ++rev;
+         self.push_block( obj->get_block(), controller::block_status::validated );
+      }
+
+      std::cerr<< "\n";
+      ilog( "${n} reversible blocks replayed", ("n",rev) );
+      auto end_time = fc::time_point::now();
+      auto replayed = head->block_num - start_block_num;
+      ilog( "replayed ${n} blocks in ${duration} seconds, ${mspb} ms/block",
+            ("n", replayed)("duration", (end_time-start).count()/1000000)
+            ("mspb", ((end_time-start).count()/1000.0)/std::max<uint32_t>(replayed, 1))        );
+      std::cerr<< "\n";
+      replaying = false;
+   }
+
+   void init( const snapshot_reader_ptr& snapshot ) {
 
       /**
       *  The fork database needs an initial block_state to be set before
       *  it can accept any new blocks. This initial block state can be found
-      *  in the database (whose head block state should be irreversible) or
-      *  it would be the genesis state.
+      *  in the database (whose head block state should be irreversible),
+      *  in a snapshot, or it would be the genesis state.
       */
-      if( !head ) {
-         initialize_fork_db(); // set head to genesis state
+      if( snapshot ) {
+         EOS_ASSERT( !head, fork_database_exception, "Snapshot can only be used to initialize an empty database" );
+         read_from_snapshot( *snapshot );
 
          auto end = blog.read_head();
-         if( end && end->block_num() > 1 ) {
-            replaying = true;
-            ilog( "existing block log, attempting to replay ${n} blocks", ("n",end->block_num()) );
-
-            auto start = fc::time_point::now();
-            while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
-               self.push_block( next, controller::block_status::irreversible );
-               if( next->block_num() % 100 == 0 ) {
-                  std::cerr << std::setw(10) << next->block_num() << " of " << end->block_num() <<"\r";
-               }
-            }
-
-            int rev = 0;
-            while( auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1) ) {
-               ++rev;
-               self.push_block( obj->get_block(), controller::block_status::validated );
+         if( !end ) {
+            blog.reset( conf.genesis, head->block );
+         } else {
+            EOS_ASSERT( end->block_num() >= head->block_num, block_log_exception,
+                        "Block log ends at block ${end} which is before the snapshot head block ${head}",
+                        ("end", end->block_num())("head", head->block_num) );
+            auto snapshot_block = blog.read_block_by_num( head->block_num );
+            EOS_ASSERT( snapshot_block && snapshot_block->id() == head->id, block_log_exception,
+                        "Block log does not contain the snapshot head block ${id}", ("id", head->id) );
+            if( end->block_num() > head->block_num ) {
+               replay( end );
             }
+         }
+      } else if( !head ) {
+         initialize_fork_db(); // set head to genesis state
 
-            std::cerr<< "\n";
-            ilog( "${n} reversible blocks replayed", ("n",rev) );
-            auto end = fc::time_point::now();
-            ilog( "replayed ${n} blocks in ${duration} seconds, ${mspb} ms/block",
-                  ("n", head->block_num)("duration", (end-start).count()/1000000)
-                  ("mspb", ((end-start).count()/1000.0)/head->block_num)        );
-            std::cerr<< "\n";
-            replaying = false;
-
+         auto end = blog.read_head();
+         if( end && end->block_num() > 1 ) {
+            EOS_ASSERT( blog.first_block_num() == 1, block_log_exception,
+                        "Block log starts at block ${n}, it can only be replayed on top of a snapshot",
+                        ("n", blog.first_block_num()) );
+            replay( end );
          } else if( !end ) {
-            blog.reset_to_genesis( conf.genesis, head->block );
+            blog.reset( conf.genesis, head->block );
          }
       }
 
@@ -266,10 +399,14 @@ struct controller_impl {
       while( db.revision() > head->block_num ) {
          db.undo();
       }
+      authorization.invalidate_cache();
 
    }
 
    ~controller_impl() {
+      thread_pool.stop();
+      thread_pool.join();
+
       pending.reset();
 
       db.flush();
@@ -279,29 +416,87 @@ struct controller_impl {
    void add_indices() {
       reversible_blocks.add_index<reversible_block_index>();
 
-      db.add_index<account_index>();
-      db.add_index<account_sequence_index>();
-
+      controller_index_set::add_indices(db);
       db.add_index<table_id_multi_index>();
-      db.add_index<key_value_index>();
-      db.add_index<index64_index>();
-      db.add_index<index128_index>();
-      db.add_index<index256_index>();
-      db.add_index<index_double_index>();
-      db.add_index<index_long_double_index>();
-
-      db.add_index<global_property_multi_index>();
-      db.add_index<dynamic_global_property_multi_index>();
-      db.add_index<block_summary_multi_index>();
-      db.add_index<transaction_multi_index>();
-      db.add_index<generated_transaction_multi_index>();
+      contract_database_index_set::add_indices(db);
 
       authorization.add_indices();
       resource_limits.add_indices();
    }
 
+   void add_to_snapshot( snapshot_writer& snapshot )const {
+      snapshot.write_section<genesis_state>([this]( auto& section ){
+         section.add_row( conf.genesis );
+      });
+
+      snapshot.write_section<block_state>([this]( auto& section ){
+         section.add_row( static_cast<const block_header_state&>(*head) );
+         section.add_row( *head->block );
+      });
+
+      controller_index_set::walk_indices([this, &snapshot]( auto utils ){
+         add_index_to_snapshot<typename decltype(utils)::index_t>( snapshot, db );
+      });
+
+      add_index_to_snapshot<table_id_multi_index>( snapshot, db );
+      contract_database_index_set::walk_indices([this, &snapshot]( auto utils ){
+         add_index_to_snapshot<typename decltype(utils)::index_t>( snapshot, db );
+      });
+
+      authorization.add_to_snapshot( snapshot );
+      resource_limits.add_to_snapshot( snapshot );
+   }
+
+   void read_from_snapshot( snapshot_reader& snapshot ) {
+      snapshot.validate();
+
+      EOS_ASSERT( db.get_index<global_property_multi_index>().indices().empty(), snapshot_exception,
+                  "Snapshot can only be used to initialize an empty database" );
+
+      snapshot.read_section<genesis_state>([this]( auto& section ){
+         genesis_state gs;
+         section.read_row( gs );
+         EOS_ASSERT( gs.compute_chain_id() == chain_id, snapshot_validation_exception,
+                     "Snapshot is of chain ${snapshot_chain_id}, not of the configured chain ${chain_id}",
+                     ("snapshot_chain_id", gs.compute_chain_id())("chain_id", chain_id) );
+      });
+
+      snapshot.read_section<block_state>([this]( auto& section ){
+         block_header_state head_header_state;
+         section.read_row( head_header_state );
+         auto head_block = std::make_shared<signed_block>();
+         section.read_row( *head_block );
+         EOS_ASSERT( head_block->id() == head_header_state.id, snapshot_validation_exception,
+                     "Snapshot head block does not match its block state" );
+
+         head = std::make_shared<block_state>( head_header_state );
+         head->block = head_block;
+         fork_db.set( head );
+      });
+
+      controller_index_set::walk_indices([this, &snapshot]( auto utils ){
+         read_index_from_snapshot<typename decltype(utils)::index_t>( snapshot, db );
+      });
+
+      snapshot_id_map<table_id> table_ids;
+      read_index_from_snapshot<table_id_multi_index>( snapshot, db, [&]( const auto& row, auto old_id ) {
+         table_ids.add( old_id, row.id );
+      });
+      contract_database_index_set::walk_indices([&]( auto utils ){
+         read_index_from_snapshot<typename decltype(utils)::index_t>( snapshot, db, [&]( auto& row, auto ) {
+            row.t_id = table_ids( row.t_id );
+         });
+      });
+
+      authorization.read_from_snapshot( snapshot );
+      resource_limits.read_from_snapshot( snapshot );
+
+      db.set_revision( head->block_num );
+   }
+
    void clear_all_undo() {
       // Rewind the database to the last irreversible block
+      authorization.invalidate_cache();
       db.with_write_lock([&] {
          db.undo_all();
          /*
@@ -417,6 +612,15 @@ struct controller_impl {
          pending.reset();
       });
 
+      // declared ahead of the timer so the line includes commit_block itself
+      bool committed = false;
+      auto log_timing_on_exit = fc::make_scoped_exit([this,&committed]{
+         if( committed && conf.log_block_timing && !replaying ) {
+            ilog( "block ${n} timing: ${t}", ("n", pending->_pending_block_state->block_num)("t", timing.block_summary()) );
+         }
+      });
+      block_timing::scoped commit_timer( timing, block_stage::commit_block );
+
       try {
          if (add_to_fork_db) {
             pending->_pending_block_state->validated = true;
@@ -443,6 +647,8 @@ struct controller_impl {
 
       // push the state for pending.
       pending->push();
+      authorization.resume_cache();
+      committed = true;
    }
 
    // The returned scoped_exit should not exceed the lifetime of the pending which existed when make_block_restore_point was called.
@@ -548,6 +754,7 @@ struct controller_impl {
 
    transaction_trace_ptr push_scheduled_transaction( const generated_transaction_object& gto, fc::time_point deadline, uint32_t billed_cpu_time_us, bool explicit_billed_cpu_time = false )
    { try {
+      block_timing::scoped trx_timer( timing, block_stage::push_scheduled_transaction );
       auto undo_session = db.start_undo_session(true);
       auto gtrx = generated_transaction(gto);
 
@@ -698,6 +905,7 @@ struct controller_impl {
    {
       EOS_ASSERT(deadline != fc::time_point(), transaction_exception, "deadline cannot be uninitialized");
 
+      block_timing::scoped trx_timer( timing, implicit ? block_stage::onblock : block_stage::push_transaction );
       transaction_trace_ptr trace;
       try {
          transaction_context trx_context(self, trx->trx, trx->id);
@@ -796,6 +1004,9 @@ struct controller_impl {
    void start_block( block_timestamp_type when, uint16_t confirm_block_count, controller::block_status s ) {
       EOS_ASSERT( !pending, block_validate_exception, "pending block is not available" );
 
+      timing.reset_block();
+      block_timing::scoped start_timer( timing, block_stage::start_block );
+
       EOS_ASSERT( db.revision() == head->block_num, database_exception, "db revision is not on par with head block",
                 ("db.revision()", db.revision())("controller_head_block", head->block_num)("fork_db_head_block", fork_db.head()->block_num) );
 
@@ -864,6 +1075,7 @@ struct controller_impl {
 
 
    void sign_block( const std::function<signature_type( const digest_type& )>& signer_callback  ) {
+      block_timing::scoped sign_timer( timing, block_stage::sign_block );
       auto p = pending->_pending_block_state;
 
       p->sign( signer_callback );
@@ -871,18 +1083,68 @@ struct controller_impl {
       static_cast<signed_block_header&>(*p->block) = p->header;
    } /// sign_block
 
+   /**
+    *  Starts the context free preparation of every input transaction of the block on the thread pool.
+    *  The returned futures are in receipt order; deferred transaction receipts get an invalid future.
+    *  The workers read the block's own packed_transactions, which publish their decoded form atomically,
+    *  so the application thread may look at the same block while they run.
+    */
+   trx_meta_futures start_trx_metadata( const signed_block_ptr& b ) {
+      trx_meta_futures result;
+      result.reserve( b->transactions.size() );
+      // keys are only needed when authorization will actually be checked, see controller::skip_auth_check
+      bool recover_keys = !replaying || conf.force_all_checks;
+      for( const auto& receipt : b->transactions ) {
+         if( receipt.trx.contains<packed_transaction>() ) {
+            const auto* pt = &receipt.trx.get<packed_transaction>();
+            result.emplace_back( async_thread_pool( thread_pool, [b, pt, recover_keys, chain_id = chain_id]() {
+               auto mtrx = std::make_shared<transaction_metadata>( *pt );
+               if( recover_keys )
+                  mtrx->recover_keys( chain_id );
+               return mtrx;
+            } ) );
+         } else {
+            result.emplace_back();
+         }
+      }
+      return result;
+   }
+
+   void prevalidate_block( const signed_block_ptr& b ) {
+      if( b->transactions.empty() ) return;
+      auto id = b->id();
+      if( prevalidated_blocks.find( id ) != prevalidated_blocks.end() ) return;
+      prevalidated_blocks.emplace( id, start_trx_metadata( b ) );
+   }
+
    void apply_block( const signed_block_ptr& b, controller::block_status s ) { try {
+      trx_meta_futures trx_metas;
+      auto itr = prevalidated_blocks.find( b->id() );
+      if( itr != prevalidated_blocks.end() ) {
+         trx_metas = std::move( itr->second );
+         prevalidated_blocks.erase( itr );
+      } else {
+         trx_metas = start_trx_metadata( b );
+      }
+      // workers reference the transactions of b, do not let them outlive a failed apply
+      auto wait_for_workers = fc::make_scoped_exit([&trx_metas]() {
+         for( auto& f : trx_metas ) {
+            if( f.valid() ) f.wait();
+         }
+      });
+
       try {
          EOS_ASSERT( b->block_extensions.size() == 0, block_validate_exception, "no supported extensions" );
          start_block( b->timestamp, b->confirmed, s );
 
          transaction_trace_ptr trace;
 
+         size_t receipt_index = 0;
          for( const auto& receipt : b->transactions ) {
             auto num_pending_receipts = pending->_pending_block_state->block->transactions.size();
+            auto& mtrx_future = trx_metas[receipt_index++];
             if( receipt.trx.contains<packed_transaction>() ) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>(pt);
+               auto mtrx = mtrx_future.get();
                trace = push_transaction( mtrx, fc::time_point::maximum(), false, receipt.cpu_usage_us, true );
             } else if( receipt.trx.contains<transaction_id_type>() ) {
                trace = push_scheduled_transaction( receipt.trx.get<transaction_id_type>(), fc::time_point::maximum(), receipt.cpu_usage_us, true );
@@ -1035,10 +1297,11 @@ struct controller_impl {
       if( pending ) {
          if ( read_mode == db_read_mode::SPECULATIVE ) {
             for( const auto& t : pending->_pending_block_state->trxs )
-               unapplied_transactions[t->signed_id] = t;
+               unapplied_transactions.add( t );
          }
          pending.reset();
       }
+      authorization.resume_cache();
    }
 
 
@@ -1070,6 +1333,7 @@ struct controller_impl {
    {
       EOS_ASSERT(pending, block_validate_exception, "it is not valid to finalize when there is no pending block");
       try {
+      block_timing::scoped finalize_timer( timing, block_stage::finalize_block );
 
 
       /*
@@ -1087,18 +1351,27 @@ struct controller_impl {
       */
 
       // Update resource limits:
-      resource_limits.process_account_limit_updates();
-      const auto& chain_config = self.get_global_properties().configuration;
-      uint32_t max_virtual_mult = 1000;
-      uint64_t CPU_TARGET = EOS_PERCENT(chain_config.max_block_cpu_usage, chain_config.target_block_cpu_usage_pct);
-      resource_limits.set_block_parameters(
-         { CPU_TARGET, chain_config.max_block_cpu_usage, config::block_cpu_usage_average_window_ms / config::block_interval_ms, max_virtual_mult, {99, 100}, {1000, 999}},
-         {EOS_PERCENT(chain_config.max_block_net_usage, chain_config.target_block_net_usage_pct), chain_config.max_block_net_usage, config::block_size_average_window_ms / config::block_interval_ms, max_virtual_mult, {99, 100}, {1000, 999}}
-      );
-      resource_limits.process_block_usage(pending->_pending_block_state->block_num);
+      {
+         block_timing::scoped resources_timer( timing, block_stage::update_resource_limits );
+         resource_limits.process_account_limit_updates();
+         const auto& chain_config = self.get_global_properties().configuration;
+         uint32_t max_virtual_mult = 1000;
+         uint64_t CPU_TARGET = EOS_PERCENT(chain_config.max_block_cpu_usage, chain_config.target_block_cpu_usage_pct);
+         resource_limits.set_block_parameters(
+            { CPU_TARGET, chain_config.max_block_cpu_usage, config::block_cpu_usage_average_window_ms / config::block_interval_ms, max_virtual_mult, {99, 100}, {1000, 999}},
+            {EOS_PERCENT(chain_config.max_block_net_usage, chain_config.target_block_net_usage_pct), chain_config.max_block_net_usage, config::block_size_average_window_ms / config::block_interval_ms, max_virtual_mult, {99, 100}, {1000, 999}}
+         );
+         resource_limits.process_block_usage(pending->_pending_block_state->block_num);
+      }
 
-      set_action_merkle();
-      set_trx_merkle();
+      {
+         block_timing::scoped merkle_timer( timing, block_stage::set_action_merkle );
+         set_action_merkle();
+      }
+      {
+         block_timing::scoped merkle_timer( timing, block_stage::set_trx_merkle );
+         set_trx_merkle();
+      }
 
       auto p = pending->_pending_block_state;
       p->id = p->header.id();
@@ -1291,16 +1564,22 @@ controller::~controller() {
 }
 
 
-void controller::startup() {
+void controller::startup( const snapshot_reader_ptr& snapshot ) {
 
    // ilog( "${c}", ("c",fc::json::to_pretty_string(cfg)) );
    my->add_indices();
 
    my->head = my->fork_db.head();
-   if( !my->head ) {
+   if( !my->head && !snapshot ) {
       elog( "No head block in fork db, perhaps we need to replay" );
    }
-   my->init();
+   my->init( snapshot );
+}
+
+void controller::write_snapshot( const snapshot_writer_ptr& snapshot )const {
+   EOS_ASSERT( !my->pending, block_validate_exception, "cannot take a consistent snapshot with a pending block" );
+   my->add_to_snapshot( *snapshot );
+   snapshot->finalize();
 }
 
 chainbase::database& controller::db()const { return my->db; }
@@ -1354,6 +1633,12 @@ transaction_trace_ptr controller::push_scheduled_transaction( const transaction_
    return my->push_scheduled_transaction( trxid, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
 }
 
+transaction_trace_ptr controller::push_scheduled_transaction( const generated_transaction_object& gto, fc::time_point deadline, uint32_t billed_cpu_time_us )
+{
+   validate_db_available_size();
+   return my->push_scheduled_transaction( gto, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
+}
+
 uint32_t controller::head_block_num()const {
    return my->head->block_num;
 }
@@ -1559,6 +1844,47 @@ wasm_interface& controller::get_wasm_interface() {
    return my->wasmif;
 }
 
+deadline_timer& controller::get_deadline_timer() {
+   return my->timer;
+}
+
+abi_serializer_ptr controller::get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
+   if( n.good() ) {
+      try {
+         const auto& a = get_account( n );
+         const auto& sequence = my->db.get<account_sequence_object, by_name>( n );
+         auto& cache = my->abi_serializer_cache;
+         auto& by_acct = cache.get<controller_impl::by_account>();
+         {
+            std::lock_guard<std::mutex> g( my->abi_serializer_cache_mutex );
+            auto itr = by_acct.find( n );
+            if( itr != by_acct.end() && itr->abi_sequence == sequence.abi_sequence ) {
+               cache.relocate( cache.begin(), cache.project<0>( itr ) );
+               return itr->serializer;
+            }
+         }
+
+         abi_serializer_ptr serializer;
+         abi_def abi;
+         if( abi_serializer::to_abi( a.abi, abi ))
+            serializer = std::make_shared<abi_serializer>( abi, max_serialization_time );
+
+         std::lock_guard<std::mutex> g( my->abi_serializer_cache_mutex );
+         by_acct.erase( n );
+         cache.push_front( controller_impl::cached_abi_serializer{ n, sequence.abi_sequence, serializer } );
+         while( cache.size() > config::default_abi_serializer_cache_size )
+            cache.pop_back();
+         return serializer;
+      } FC_CAPTURE_AND_LOG((n))
+   }
+   return abi_serializer_ptr();
+}
+
+void controller::invalidate_abi_serializer( account_name n ) {
+   std::lock_guard<std::mutex> g( my->abi_serializer_cache_mutex );
+   my->abi_serializer_cache.get<controller_impl::by_account>().erase( n );
+}
+
 const account_object& controller::get_account( account_name name )const
 { try {
    return my->db.get<account_object, by_name>(name);
@@ -1568,8 +1894,9 @@ vector<transaction_metadata_ptr> controller::get_unapplied_transactions() const
    vector<transaction_metadata_ptr> result;
    if ( my->read_mode == db_read_mode::SPECULATIVE ) {
       result.reserve(my->unapplied_transactions.size());
-      for ( const auto& entry: my->unapplied_transactions ) {
-         result.emplace_back(entry.second);
+      uint64_t cursor = 0;
+      while( auto trx = my->unapplied_transactions.next( cursor ) ) {
+         result.emplace_back( std::move(trx) );
       }
    } else {
       EOS_ASSERT( my->unapplied_transactions.empty(), transaction_exception, "not empty unapplied_transactions in non-speculative mode" ); //should never happen
@@ -1581,6 +1908,18 @@ void controller::drop_unapplied_transaction(const transaction_metadata_ptr& trx)
    my->unapplied_transactions.erase(trx->signed_id);
 }
 
+const unapplied_transaction_queue& controller::get_unapplied_transaction_queue()const {
+   return my->unapplied_transactions;
+}
+
+vector<block_stage_timing> controller::get_block_timings()const {
+   return my->timing.get_timings();
+}
+
+size_t controller::drop_expired_unapplied_transactions( fc::time_point now ) {
+   return my->unapplied_transactions.erase_expired( now );
+}
+
 vector<transaction_id_type> controller::get_scheduled_transactions() const {
    const auto& idx = db().get_index<generated_transaction_multi_index,by_delay>();
 
@@ -1597,6 +1936,28 @@ vector<transaction_id_type> controller::get_scheduled_transactions() const {
    return result;
 }
 
+const generated_transaction_object* controller::next_scheduled_transaction( scheduled_transaction_cursor& cursor )const {
+   const auto& idx = db().get_index<generated_transaction_multi_index,by_delay>();
+
+   // transactions scheduled after the walk started are left for the next block, even with no delay, as when the
+   // ready ids were collected before pushing any; those scheduled earlier in this block (by the unapplied and
+   // persisted transactions) are still returned. An existing transaction rescheduled by replace_existing keeps
+   // its id, so it is returned if it is ready and the cursor has not passed its new position.
+   if( cursor.end_id < 0 ) {
+      const auto& by_id_idx = db().get_index<generated_transaction_multi_index,by_id>();
+      cursor.end_id = by_id_idx.empty() ? 0 : by_id_idx.rbegin()->id._id + 1;
+   }
+
+   auto itr = idx.lower_bound( boost::make_tuple( cursor.delay_until, generated_transaction_object::id_type( cursor.next_id ) ) );
+   for( ; itr != idx.end() && itr->delay_until <= pending_block_time(); ++itr ) {
+      cursor.delay_until = itr->delay_until;
+      cursor.next_id     = itr->id._id + 1;
+      if( itr->id._id < cursor.end_id )
+         return &*itr;
+   }
+   return nullptr;
+}
+
 void controller::check_contract_list( account_name code )const {
    my->check_contract_list( code );
 }
@@ -0,0 +1,60 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/deadline_timer.hpp>
+
+#include <chrono>
+
+namespace eosio { namespace chain {
+
+   deadline_timer::deadline_timer()
+   :thread( [this]() { run(); } )
+   {
+   }
+
+   deadline_timer::~deadline_timer() {
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         shutdown = true;
+      }
+      cv.notify_one();
+      thread.join();
+   }
+
+   void deadline_timer::start( fc::time_point deadline ) {
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         if( deadline != fc::time_point::maximum() && fc::time_point::now() >= deadline ) {
+            // already passed, do not leave a window where the caller sees an unexpired timer
+            expired = true;
+            armed_deadline = fc::time_point::maximum();
+         } else {
+            expired = false;
+            armed_deadline = deadline;
+         }
+      }
+      cv.notify_one();
+   }
+
+   void deadline_timer::stop() {
+      start( fc::time_point::maximum() );
+   }
+
+   void deadline_timer::run() {
+      std::unique_lock<std::mutex> g( mtx );
+      while( !shutdown ) {
+         if( armed_deadline == fc::time_point::maximum() ) {
+            cv.wait( g );
+            continue;
+         }
+         cv.wait_until( g, std::chrono::system_clock::time_point( std::chrono::microseconds( armed_deadline.time_since_epoch().count() ) ) );
+         // woken by start(), stop() or the deadline itself; only the latter leaves an armed deadline that has passed
+         if( armed_deadline != fc::time_point::maximum() && fc::time_point::now() >= armed_deadline ) {
+            expired = true;
+            armed_deadline = fc::time_point::maximum();
+         }
+      }
+   }
+
+} } // eosio::chain
@@ -169,6 +169,10 @@ void apply_eosio_setcode(apply_context& context) {
    if (new_size != old_size) {
       context.trx_context.add_ram_usage( act.account, new_size - old_size );
    }
+
+   if( code_size > 0 ) {
+      context.control.get_wasm_interface().compile_async( code_id, act.code );
+   }
 }
 
 void apply_eosio_setabi(apply_context& context) {
@@ -195,6 +199,9 @@ void apply_eosio_setabi(apply_context& context) {
       aso.abi_sequence += 1;
    });
 
+   // the sequence alone does not identify the ABI once blocks are popped and a fork sets a different one
+   context.control.invalidate_abi_serializer( act.account );
+
    if (new_size != old_size) {
       context.trx_context.add_ram_usage( act.account, new_size - old_size );
    }
@@ -319,6 +326,7 @@ void apply_eosio_linkauth(apply_context& context) {
 
       auto link_key = boost::make_tuple(requirement.account, requirement.code, requirement.type);
       auto link = db.find<permission_link_object, by_action_name>(link_key);
+      context.control.get_mutable_authorization_manager().invalidate_cache();
 
       if( link ) {
          EOS_ASSERT(link->required_permission != requirement.requirement, action_validate_exception,
@@ -359,6 +367,7 @@ void apply_eosio_unlinkauth(apply_context& context) {
       -(int64_t)(config::billable_size_v<permission_link_object>)
    );
 
+   context.control.get_mutable_authorization_manager().invalidate_cache();
    db.remove(*link);
 }
 
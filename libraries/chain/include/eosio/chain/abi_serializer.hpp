@@ -46,6 +46,8 @@ struct abi_serializer {
 
    type_name get_action_type(name action)const;
    type_name get_table_type(name action)const;
+   /// index type of the table as declared in the ABI ("i64", ...), empty if the table is not declared
+   type_name get_table_index_type(name table)const;
 
    optional<string>  get_error_message( uint64_t error_code )const;
 
@@ -59,6 +61,15 @@ struct abi_serializer {
    fc::variant binary_to_variant(const type_name& type, fc::datastream<const char*>& binary, const fc::microseconds& max_serialization_time)const {
       return _binary_to_variant(type, binary, 0, fc::time_point::now() + max_serialization_time, max_serialization_time);
    }
+
+   /**
+    *  Appends the JSON text of binary to out. The output is the same as fc::json::to_string(binary_to_variant(...)),
+    *  but structs and arrays are written as they are decoded instead of being built up as a variant tree first.
+    */
+   void        binary_to_json(const type_name& type, const bytes& binary, string& out, const fc::microseconds& max_serialization_time)const {
+      fc::datastream<const char*> ds( binary.data(), binary.size() );
+      _binary_to_json(type, ds, out, 0, fc::time_point::now() + max_serialization_time, max_serialization_time);
+   }
    void        variant_to_binary(const type_name& type, const fc::variant& var, fc::datastream<char*>& ds, const fc::microseconds& max_serialization_time)const {
       _variant_to_binary(type, var, ds, 0, fc::time_point::now() + max_serialization_time, max_serialization_time);
    }
@@ -97,11 +108,55 @@ private:
    map<type_name, struct_def> structs;
    map<name,type_name>        actions;
    map<name,type_name>        tables;
+   map<name,type_name>        table_index_types;
    map<uint64_t, string>      error_messages;
 
    map<type_name, pair<unpack_function, pack_function>> built_in_types;
    void configure_built_in_types();
 
+   /**
+    *  set_abi compiles every type named by the ABI into a flat table: typedefs are resolved, the fields of
+    *  base structs are inlined and field types refer to other entries by index. Converting a value of one
+    *  of these types then costs a single lookup of the top level type instead of map lookups and string
+    *  manipulation for every field of every row.
+    */
+   struct compiled_field {
+      field_name name;
+      string     json_key; ///< name as an escaped JSON string followed by ':'
+      uint32_t   type = 0;
+   };
+
+   struct compiled_type {
+      enum kind_t : uint8_t { builtin, array, optional, structure };
+
+      type_name                             name;
+      kind_t                                kind = builtin;
+      pair<unpack_function, pack_function>  builtin_functions; ///< builtin only, is_array/is_optional are passed to them
+      bool                                  is_array = false;
+      bool                                  is_optional = false;
+      uint32_t                              element = 0;       ///< array and optional
+      bool                                  has_base = false;  ///< structure
+      /// structure, a derived field shadows a base field; the variant keeps one key for both, so JSON goes through it
+      bool                                  has_shadowed_fields = false;
+      vector<compiled_field>                fields;            ///< structure, base fields first
+   };
+
+   vector<compiled_type>      compiled_types;
+   map<type_name, uint32_t>   compiled_type_index;
+
+   void     compile_types();
+   uint32_t compile_type(const type_name& type);
+   void     compile_fields(const struct_def& st, vector<compiled_field>& fields);
+
+   fc::variant _binary_to_variant(uint32_t type, fc::datastream<const char*>& stream,
+                                  size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time)const;
+   void        _variant_to_binary(uint32_t type, const fc::variant& var, fc::datastream<char*>& ds,
+                                  size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time)const;
+   bool        _binary_to_json(uint32_t type, fc::datastream<const char*>& stream, string& out,
+                               size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time)const;
+   void        _binary_to_json(const type_name& type, fc::datastream<const char*>& stream, string& out,
+                               size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time)const;
+
    fc::variant _binary_to_variant(const type_name& type, const bytes& binary,
                                   size_t recursion_depth, const fc::time_point& deadline, const fc::microseconds& max_serialization_time)const;
    bytes       _variant_to_binary(const type_name& type, const fc::variant& var,
@@ -123,6 +178,8 @@ private:
    friend struct impl::abi_to_variant;
 };
 
+using abi_serializer_ptr = std::shared_ptr<const abi_serializer>;
+
 namespace impl {
    /**
     * Determine if a type contains ABI related info, perhaps deeply nested
@@ -284,7 +341,7 @@ namespace impl {
          mvo("authorization", act.authorization);
 
          auto abi = resolver(act.account);
-         if (abi.valid()) {
+         if (abi) {
             auto type = abi->get_action_type(act.name);
             if (!type.empty()) {
                try {
@@ -460,7 +517,7 @@ namespace impl {
                valid_empty_data = act.data.empty();
             } else if ( data.is_object() ) {
                auto abi = resolver(act.account);
-               if (abi.valid()) {
+               if (abi) {
                   auto type = abi->get_action_type(act.name);
                   if (!type.empty()) {
                      act.data = std::move( abi->_variant_to_binary( type, data, recursion_depth, deadline, max_serialization_time ));
@@ -5,6 +5,7 @@
 #pragma once
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction.hpp>
+#include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/contract_table_objects.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
@@ -20,36 +21,104 @@ class transaction_context;
 
 class apply_context {
    private:
-      template<typename T>
-      class iterator_cache {
+      /**
+       * Open addressing map from a 64 bit key (a table id or an object address) to an iterator, probing linearly
+       * in one array. Nothing is allocated until the first insert, and clear() keeps the array for reuse.
+       * -1 is never a cached iterator, so it marks empty slots.
+       */
+      class iterator_map {
          public:
-            iterator_cache(){
-               _end_iterator_to_table.reserve(8);
-               _iterator_to_object.reserve(32);
+            /// Returns -1 if the key is not in the map
+            int find( uint64_t key )const {
+               if( _slots.empty() ) return -1;
+               for( size_t i = home_slot(key); ; i = next_slot(i) ) {
+                  if( _slots[i].value == -1 ) return -1;
+                  if( _slots[i].key == key ) return _slots[i].value;
+               }
+            }
+
+            /// Precondition: key is not in the map
+            void insert( uint64_t key, int value ) {
+               if( (_size + 1) * 4 > _slots.size() * 3 )
+                  grow();
+               place( key, value );
+               ++_size;
             }
 
+            void erase( uint64_t key ) {
+               if( _slots.empty() ) return;
+               size_t i = home_slot(key);
+               for( ; _slots[i].key != key || _slots[i].value == -1; i = next_slot(i) ) {
+                  if( _slots[i].value == -1 ) return;
+               }
+               // shift later entries of the probe sequence back instead of leaving a tombstone
+               for( size_t j = next_slot(i); _slots[j].value != -1; j = next_slot(j) ) {
+                  const size_t home = home_slot(_slots[j].key);
+                  const bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+                  if( !stays ) {
+                     _slots[i] = _slots[j];
+                     i = j;
+                  }
+               }
+               _slots[i].value = -1;
+               --_size;
+            }
+
+            void clear() {
+               for( auto& s : _slots ) s.value = -1;
+               _size = 0;
+            }
+
+         private:
+            struct slot {
+               uint64_t key   = 0;
+               int      value = -1;
+            };
+
+            size_t home_slot( uint64_t key )const { return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & (_slots.size() - 1); }
+            size_t next_slot( size_t i )const     { return (i + 1) & (_slots.size() - 1); }
+
+            void place( uint64_t key, int value ) {
+               size_t i = home_slot(key);
+               while( _slots[i].value != -1 ) i = next_slot(i);
+               _slots[i].key = key;
+               _slots[i].value = value;
+            }
+
+            void grow() {
+               vector<slot> old( std::max<size_t>( 8, _slots.size() * 2 ) );
+               std::swap( old, _slots );
+               for( const auto& s : old )
+                  if( s.value != -1 ) place( s.key, s.value );
+            }
+
+            vector<slot> _slots; ///< size is zero or a power of two
+            size_t       _size = 0;
+      };
+
+      template<typename T>
+      class iterator_cache {
+         public:
             /// Returns end iterator of the table.
             int cache_table( const table_id_object& tobj ) {
-               auto itr = _table_cache.find(tobj.id);
-               if( itr != _table_cache.end() )
-                  return itr->second.second;
+               auto ei = _table_cache.find( table_key(tobj.id) );
+               if( ei != -1 )
+                  return ei;
 
-               auto ei = index_to_end_iterator(_end_iterator_to_table.size());
+               ei = index_to_end_iterator(_end_iterator_to_table.size());
                _end_iterator_to_table.push_back( &tobj );
-               _table_cache.emplace( tobj.id, make_pair(&tobj, ei) );
+               _table_cache.insert( table_key(tobj.id), ei );
                return ei;
             }
 
             const table_id_object& get_table( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return *itr->second.first;
+               return *_end_iterator_to_table[end_iterator_to_index(get_end_iterator_by_table_id(i))];
             }
 
             int get_end_iterator_by_table_id( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return itr->second.second;
+               auto ei = _table_cache.find( table_key(i) );
+               EOS_ASSERT( ei != -1, table_not_in_cache, "an invariant was broken, table should be in cache" );
+               return ei;
             }
 
             const table_id_object* find_table_by_end_iterator( int ei )const {
@@ -75,25 +144,28 @@ class apply_context {
                auto obj_ptr = _iterator_to_object[iterator];
                if( !obj_ptr ) return;
                _iterator_to_object[iterator] = nullptr;
-               _object_to_iterator.erase( obj_ptr );
+               _object_to_iterator.erase( object_key(obj_ptr) );
             }
 
             int add( const T& obj ) {
-               auto itr = _object_to_iterator.find( &obj );
-               if( itr != _object_to_iterator.end() )
-                    return itr->second;
+               auto itr = _object_to_iterator.find( object_key(&obj) );
+               if( itr != -1 )
+                    return itr;
 
                _iterator_to_object.push_back( &obj );
-               _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
+               _object_to_iterator.insert( object_key(&obj), _iterator_to_object.size() - 1 );
 
                return _iterator_to_object.size() - 1;
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            iterator_map                    _table_cache;          ///< table id to end iterator
+            vector<const table_id_object*>  _end_iterator_to_table;
+            vector<const T*>                _iterator_to_object;
+            iterator_map                    _object_to_iterator;
+
+            static uint64_t table_key( table_id_object::id_type i ) { return uint64_t(i._id); }
+            static uint64_t object_key( const T* obj )               { return uint64_t(reinterpret_cast<uintptr_t>(obj)); }
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
@@ -464,10 +536,16 @@ class apply_context {
       ,idx256(*this)
       ,idx_double(*this)
       ,idx_long_double(*this)
+      ,_buffers(trx_ctx.take_apply_buffers())
+      ,_pending_console_output(trx_ctx._console_stream)
       {
          reset_console();
       }
 
+      ~apply_context() {
+         trx_context.return_apply_buffers( std::move(_buffers) );
+      }
+
 
    /// Execution methods:
    public:
@@ -603,10 +681,8 @@ class apply_context {
    private:
 
       iterator_cache<key_value_object>    keyval_cache;
-      vector<account_name>                _notified; ///< keeps track of new accounts to be notifed of current message
-      vector<action>                      _inline_actions; ///< queued inline messages
-      vector<action>                      _cfa_inline_actions; ///< queued inline messages
-      std::ostringstream                  _pending_console_output;
+      apply_context_buffers               _buffers; ///< borrowed from trx_context for the life of this context
+      std::ostringstream&                 _pending_console_output; ///< owned by trx_context
 
       //bytes                               _cached_trx;
 };
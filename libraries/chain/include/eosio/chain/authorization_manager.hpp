@@ -9,10 +9,14 @@
 
 #include <utility>
 #include <functional>
+#include <map>
+#include <tuple>
 
 namespace eosio { namespace chain {
 
    class controller;
+   class snapshot_writer;
+   class snapshot_reader;
    struct updateauth;
    struct deleteauth;
    struct linkauth;
@@ -27,6 +31,8 @@ namespace eosio { namespace chain {
 
          void add_indices();
          void initialize_database();
+         void add_to_snapshot( snapshot_writer& snapshot )const;
+         void read_from_snapshot( snapshot_reader& snapshot );
 
          const permission_object& create_permission( account_name account,
                                                      permission_name name,
@@ -112,6 +118,15 @@ namespace eosio { namespace chain {
                                                     )const;
 
 
+         /**
+          * Drops the cached link lookups and authorization results and stops caching, because the permission or link
+          * that changed may still be undone. Called for every change to permissions and links and when a block is popped.
+          */
+         void invalidate_cache();
+
+         /// Resumes caching once the changes that invalidated the cache are committed with their block or aborted
+         void resume_cache();
+
          static std::function<void()> _noop_checktime;
 
       private:
@@ -128,6 +143,24 @@ namespace eosio { namespace chain {
                                                              scope_name code_account,
                                                              action_name type
                                                            )const;
+
+         struct authorization_result {
+            bool                      satisfied = false;
+            flat_set<public_key_type> used_keys;
+         };
+         using linked_permission_key = std::tuple<account_name, scope_name, action_name>;
+         using authorization_key     = std::pair<permission_level, fc::microseconds>;
+
+         /**
+          * Results of lookup_linked_permission, and of checking a permission level under a delay against a set of
+          * provided keys. They depend only on the permissions and links in the database, so they are only kept
+          * while there are no changes to those that could still be undone.
+          */
+         mutable std::map<linked_permission_key, optional<permission_name>>                                   _linked_permission_cache;
+         mutable std::map<flat_set<public_key_type>, std::map<authorization_key, authorization_result>>       _authorization_cache;
+         mutable size_t                                                                                       _authorization_cache_size = 0;
+         mutable uint16_t                                                                                     _authorization_cache_depth = 0;
+         bool                                                                                                 _cache_suspended = true;
    };
 
 } } /// namespace eosio::chain
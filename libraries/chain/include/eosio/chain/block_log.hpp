@@ -6,6 +6,7 @@
 #include <fc/filesystem.hpp>
 #include <eosio/chain/block.hpp>
 #include <eosio/chain/genesis_state.hpp>
+#include <eosio/chain/config.hpp>
 
 namespace eosio { namespace chain {
 
@@ -34,17 +35,29 @@ namespace eosio { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * A log started from a snapshot does not begin at block 1. Since version 2 the number of the first
+    * block in the log is written after the version, and the index file holds the positions of the
+    * blocks starting at that block number.
+    *
+    * Both files are written through append only handles and read through read only memory mappings,
+    * so readers never reposition the write handles. The last cache_size blocks that were read or
+    * appended are kept deserialized; every caller gets its own copy.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, uint32_t cache_size = config::default_block_log_cache_size);
          block_log(block_log&& other);
          ~block_log();
 
          uint64_t append(const signed_block_ptr& b);
          void flush();
-         uint64_t reset_to_genesis( const genesis_state& gs, const signed_block_ptr& genesis_block );
+         /**
+          * Discard the log and start a new one with first_block, which is the genesis block unless the
+          * chain state was loaded from a snapshot.
+          */
+         uint64_t reset( const genesis_state& gs, const signed_block_ptr& first_block );
 
          std::pair<signed_block_ptr, uint64_t> read_block(uint64_t file_pos)const;
          signed_block_ptr read_block_by_num(uint32_t block_num)const;
@@ -58,9 +71,11 @@ namespace eosio { namespace chain {
          uint64_t get_block_pos(uint32_t block_num) const;
          signed_block_ptr        read_head()const;
          const signed_block_ptr& head()const;
+         uint32_t                first_block_num()const;
 
          static const uint64_t npos = std::numeric_limits<uint64_t>::max();
 
+         static const uint32_t min_supported_version;
          static const uint32_t supported_version;
 
          static fc::path repair_log( const fc::path& data_dir, uint32_t truncate_at_block = 0 );
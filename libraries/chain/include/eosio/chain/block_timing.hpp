@@ -0,0 +1,106 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * The stages of producing or validating a block that the controller times. onblock is the implicit
+    * transaction run by start_block; its time is also part of start_block.
+    */
+   enum class block_stage {
+      start_block,
+      onblock,
+      push_transaction,
+      push_scheduled_transaction,
+      finalize_block,
+      update_resource_limits,
+      set_action_merkle,
+      set_trx_merkle,
+      sign_block,
+      commit_block,
+      on_irreversible,
+      stage_count
+   };
+
+   const char* to_string( block_stage s );
+
+   /// statistics over the most recent samples of one stage, durations in microseconds
+   struct block_stage_timing {
+      std::string           stage;
+      uint64_t              count = 0;        ///< samples since startup
+      int64_t               total_us = 0;     ///< sum of the samples since startup
+      uint64_t              window_count = 0; ///< samples the remaining fields are computed over
+      int64_t               min_us = 0;
+      int64_t               avg_us = 0;
+      int64_t               p50_us = 0;
+      int64_t               p90_us = 0;
+      int64_t               p99_us = 0;
+      int64_t               max_us = 0;
+      /// histogram of the window, buckets[i] counts the samples below 2^i microseconds (and at least 2^(i-1))
+      std::vector<uint64_t> buckets;
+   };
+
+   /**
+    * Rolling timings of the block stages, kept in a ring of the last `window` samples per stage so a
+    * slow period is not averaged away by the node's whole history. Recording is a clock read and a ring
+    * write under an uncontended mutex; percentiles and histograms are only computed when asked for.
+    *
+    * The totals of the block being built are kept separately for the per block log line.
+    */
+   class block_timing {
+      public:
+         static constexpr uint32_t default_window = 1024;
+         static constexpr uint32_t bucket_count   = 24; ///< the last bucket holds everything from ~8 seconds up
+
+         explicit block_timing( uint32_t window = default_window );
+
+         void record( block_stage s, fc::microseconds elapsed );
+
+         /// times the enclosing scope as stage `s`
+         class scoped {
+            public:
+               scoped( block_timing& t, block_stage s ):_timing(t),_stage(s),_start(fc::time_point::now()) {}
+               ~scoped() { _timing.record( _stage, fc::time_point::now() - _start ); }
+               scoped( const scoped& ) = delete;
+               scoped& operator=( const scoped& ) = delete;
+            private:
+               block_timing&  _timing;
+               block_stage    _stage;
+               fc::time_point _start;
+         };
+
+         std::vector<block_stage_timing> get_timings()const;
+
+         /// clears the totals of the current block, called when a block is started
+         void reset_block();
+         /// one line summary of the current block, "start_block 120us, push_transaction 35x 2300us, ..."
+         std::string block_summary()const;
+
+      private:
+         struct stage_samples {
+            std::vector<int64_t> ring;
+            uint64_t             count = 0;
+            int64_t              total_us = 0;
+            int64_t              block_total_us = 0;
+            uint32_t             block_count = 0;
+         };
+
+         mutable std::mutex                                                   _mutex;
+         uint32_t                                                             _window;
+         std::array<stage_samples, static_cast<size_t>(block_stage::stage_count)> _stages;
+   };
+
+} } // eosio::chain
+
+FC_REFLECT( eosio::chain::block_stage_timing, (stage)(count)(total_us)(window_count)(min_us)(avg_us)(p50_us)(p90_us)(p99_us)(max_us)(buckets) )
@@ -19,6 +19,7 @@ const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 340 bl
 
 const static auto default_state_dir_name     = "state";
 const static auto forkdb_filename            = "forkdb.dat";
+const static auto default_code_cache_dir_name = "code_cache";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      = 128*1024*1024ll;
 
@@ -95,6 +96,13 @@ const static uint32_t   hashing_checktime_block_size       = 10*1024;  /// call
 
 const static eosio::chain::wasm_interface::vm_type default_wasm_runtime = eosio::chain::wasm_interface::vm_type::binaryen;
 const static uint32_t   default_abi_serializer_max_time_ms = 15*1000; ///< default deadline for abi serialization methods
+const static uint32_t   default_wasm_cache_max_entries     = 1024;             ///< instantiated contracts kept by the wasm interface
+const static uint64_t   default_wasm_cache_max_code_size   = 256*1024*1024ll;  ///< total contract size the wasm interface keeps instantiated
+
+const static uint16_t   default_controller_thread_pool_size = 2;  ///< worker threads used for context free block and transaction validation
+const static uint32_t   block_prevalidation_depth           = 16; ///< number of blocks whose transactions are prepared ahead of execution during replay
+const static uint32_t   default_block_log_cache_size        = 256; ///< number of recently read or appended blocks kept deserialized by the block log
+const static uint32_t   default_abi_serializer_cache_size   = 512; ///< number of accounts whose abi_serializer the controller keeps for read APIs
 
 /**
  *  The number of sequential blocks produced by a single producer
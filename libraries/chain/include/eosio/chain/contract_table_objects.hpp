@@ -216,5 +216,10 @@ CHAINBASE_SET_INDEX_TYPE(eosio::chain::index256_object, eosio::chain::index256_i
 CHAINBASE_SET_INDEX_TYPE(eosio::chain::index_double_object, eosio::chain::index_double_index)
 CHAINBASE_SET_INDEX_TYPE(eosio::chain::index_long_double_object, eosio::chain::index_long_double_index)
 
-FC_REFLECT(eosio::chain::table_id_object, (id)(code)(scope)(table) )
+FC_REFLECT(eosio::chain::table_id_object, (id)(code)(scope)(table)(payer)(count) )
 FC_REFLECT(eosio::chain::key_value_object, (id)(t_id)(primary_key)(value)(payer) )
+FC_REFLECT(eosio::chain::index64_object, (id)(t_id)(primary_key)(payer)(secondary_key) )
+FC_REFLECT(eosio::chain::index128_object, (id)(t_id)(primary_key)(payer)(secondary_key) )
+FC_REFLECT(eosio::chain::index256_object, (id)(t_id)(primary_key)(payer)(secondary_key) )
+FC_REFLECT(eosio::chain::index_double_object, (id)(t_id)(primary_key)(payer)(secondary_key) )
+FC_REFLECT(eosio::chain::index_long_double_object, (id)(t_id)(primary_key)(payer)(secondary_key) )
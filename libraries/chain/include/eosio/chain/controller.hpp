@@ -6,6 +6,8 @@
 
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/account_object.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/block_timing.hpp>
 
 namespace chainbase {
    class database;
@@ -15,6 +17,9 @@ namespace chainbase {
 namespace eosio { namespace chain {
 
    class authorization_manager;
+   class deadline_timer;
+   class unapplied_transaction_queue;
+   class generated_transaction_object;
 
    namespace resource_limits {
       class resource_limits_manager;
@@ -24,6 +29,16 @@ namespace eosio { namespace chain {
    using chainbase::database;
    using boost::signals2::signal;
 
+   /**
+    * Position in the delay-ordered queue of scheduled transactions, see controller::next_scheduled_transaction.
+    * A default constructed cursor starts at the front of the queue.
+    */
+   struct scheduled_transaction_cursor {
+      fc::time_point delay_until;
+      int64_t        next_id = 0;
+      int64_t        end_id = -1;  ///< ids from here on were scheduled after the first call, -1 until then
+   };
+
    class dynamic_global_property_object;
    class global_property_object;
    class permission_object;
@@ -66,6 +81,11 @@ namespace eosio { namespace chain {
             db_read_mode             read_mode    = db_read_mode::SPECULATIVE;   /** ݿģʽ */
 
             flat_set<account_name>   resource_greylist;  /** Դ */
+
+            uint16_t                 thread_pool_size       =  chain::config::default_controller_thread_pool_size; ///< threads used for context free validation of incoming blocks
+            wasm_interface::cache_limits wasm_cache_limits{ chain::config::default_wasm_cache_max_entries,
+                                                            chain::config::default_wasm_cache_max_code_size };
+            bool                     log_block_timing       =  false;   ///< log the time spent in each stage of every committed block
          };
 
          enum class block_status {
@@ -82,7 +102,16 @@ namespace eosio { namespace chain {
          controller( const config& cfg );
          ~controller();
 
-         void startup();
+         /**
+          * Opens the chain state. When a snapshot is given the state database must be empty, it is built from the
+          * snapshot and the block log is only replayed past the snapshot head block.
+          */
+         void startup( const snapshot_reader_ptr& snapshot = snapshot_reader_ptr() );
+
+         /**
+          * Writes the state as of the head block. There must be no pending block.
+          */
+         void write_snapshot( const snapshot_writer_ptr& snapshot )const;
 
          /**
           * Starts a new pending block session upon which new transactions can
@@ -104,6 +133,18 @@ namespace eosio { namespace chain {
          vector<transaction_metadata_ptr> get_unapplied_transactions() const;
          void drop_unapplied_transaction(const transaction_metadata_ptr& trx);
 
+         /**
+          *  The unapplied transactions in arrival order, for callers that walk them without copying (see
+          *  unapplied_transaction_queue::next). Transactions are removed as they are applied or dropped.
+          */
+         const unapplied_transaction_queue& get_unapplied_transaction_queue()const;
+
+         /// rolling timings of the stages of producing and validating blocks, see block_timing
+         vector<block_stage_timing> get_block_timings()const;
+
+         /// @return the number of unapplied transactions that expired before `now` and were dropped
+         size_t drop_expired_unapplied_transactions( fc::time_point now );
+
          /**
           * These transaction IDs represent transactions available in the head chain state as scheduled
           * or otherwise generated transactions.
@@ -115,6 +156,17 @@ namespace eosio { namespace chain {
           */
          vector<transaction_id_type> get_scheduled_transactions() const;
 
+         /**
+          * Returns the next scheduled transaction after `cursor` that is ready at the pending block time and moves
+          * the cursor past it, or nullptr when no more are ready. Unlike get_scheduled_transactions this resumes
+          * where the previous call stopped instead of rescanning the queue, and remains valid while the returned
+          * transactions are pushed or cancelled. Transactions scheduled after the first call with `cursor` are not
+          * returned, so create the cursor when the walk starts.
+          *
+          * The returned object is only valid until the next call that modifies the chain state.
+          */
+         const generated_transaction_object* next_scheduled_transaction( scheduled_transaction_cursor& cursor )const;
+
          /**
           *
           */
@@ -125,6 +177,7 @@ namespace eosio { namespace chain {
           *
           */
          transaction_trace_ptr push_scheduled_transaction( const transaction_id_type& scheduled, fc::time_point deadline, uint32_t billed_cpu_time_us = 0 );
+         transaction_trace_ptr push_scheduled_transaction( const generated_transaction_object& scheduled, fc::time_point deadline, uint32_t billed_cpu_time_us = 0 );
 
          void finalize_block();
          void sign_block( const std::function<signature_type( const digest_type& )>& signer_callback );
@@ -233,19 +286,16 @@ namespace eosio { namespace chain {
 
          const apply_handler* find_apply_handler( account_name contract, scope_name scope, action_name act )const;
          wasm_interface& get_wasm_interface();
+         deadline_timer& get_deadline_timer();
 
 
-         optional<abi_serializer> get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
-            if( n.good() ) {
-               try {
-                  const auto& a = get_account( n );
-                  abi_def abi;
-                  if( abi_serializer::to_abi( a.abi, abi ))
-                     return abi_serializer( abi, max_serialization_time );
-               } FC_CAPTURE_AND_LOG((n))
-            }
-            return optional<abi_serializer>();
-         }
+         /**
+          * Returns the serializer for the current ABI of the account, or nullptr if it has none. Serializers
+          * are built once per ABI version (abi_sequence) and shared between callers.
+          */
+         abi_serializer_ptr get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const;
+         /// drops the cached serializer of the account, called by setabi
+         void invalidate_abi_serializer( account_name n );
 
          template<typename T>
          fc::variant to_variant_with_abi( const T& obj, const fc::microseconds& max_serialization_time ) {
@@ -279,4 +329,5 @@ FC_REFLECT( eosio::chain::controller::config,
             (genesis)
             (wasm_runtime)
             (resource_greylist)
+            (wasm_cache_limits)
           )
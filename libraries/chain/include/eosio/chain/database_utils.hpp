@@ -0,0 +1,161 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/types.hpp>
+#include <fc/io/raw.hpp>
+#include <softfloat.hpp>
+#include <chainbase/chainbase.hpp>
+
+#include <array>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Helpers for visiting every row of a chainbase index in id order and for creating rows in it.
+    */
+   template<typename Index>
+   struct index_utils {
+      using index_t = Index;
+      using value_type = typename index_t::value_type;
+
+      template<typename F>
+      static void walk( const chainbase::database& db, F&& function ) {
+         const auto& index = db.get_index<Index>().indices();
+         for( auto itr = index.begin(); itr != index.end(); ++itr ) {
+            function( *itr );
+         }
+      }
+
+      template<typename F>
+      static const value_type& create( chainbase::database& db, F&& cons ) {
+         return db.create<value_type>( std::forward<F>(cons) );
+      }
+   };
+
+   /**
+    * A compile time list of chainbase indices so that the same list drives both registering the
+    * indices with the database and visiting them (e.g. when writing or reading a snapshot).
+    */
+   template<typename ...Indices>
+   class index_set;
+
+   template<typename Index>
+   class index_set<Index> {
+      public:
+         static void add_indices( chainbase::database& db ) {
+            db.add_index<Index>();
+         }
+
+         template<typename F>
+         static void walk_indices( F&& function ) {
+            function( index_utils<Index>() );
+         }
+   };
+
+   template<typename FirstIndex, typename ...RemainingIndices>
+   class index_set<FirstIndex, RemainingIndices...> {
+      public:
+         static void add_indices( chainbase::database& db ) {
+            index_set<FirstIndex>::add_indices( db );
+            index_set<RemainingIndices...>::add_indices( db );
+         }
+
+         template<typename F>
+         static void walk_indices( F&& function ) {
+            index_set<FirstIndex>::walk_indices( function );
+            index_set<RemainingIndices...>::walk_indices( function );
+         }
+   };
+
+} }
+
+/**
+ * Binary serialization of the shared memory types used by chainbase objects, so that whole rows can be
+ * packed with fc::raw through their reflection.
+ */
+namespace fc { namespace raw {
+
+   template<typename Stream, typename OidType>
+   inline void pack( Stream& s, const chainbase::oid<OidType>& id ) {
+      fc::raw::pack( s, id._id );
+   }
+
+   template<typename Stream, typename OidType>
+   inline void unpack( Stream& s, chainbase::oid<OidType>& id ) {
+      fc::raw::unpack( s, id._id );
+   }
+
+   template<typename Stream>
+   inline void pack( Stream& s, const eosio::chain::shared_string& str ) {
+      fc::raw::pack( s, unsigned_int((uint32_t)str.size()) );
+      if( str.size() )
+         s.write( str.data(), str.size() );
+   }
+
+   template<typename Stream>
+   inline void unpack( Stream& s, eosio::chain::shared_string& str ) {
+      unsigned_int size;
+      fc::raw::unpack( s, size );
+      str.resize( size.value );
+      if( size.value )
+         s.read( &str[0], size.value );
+   }
+
+   template<typename Stream, typename T>
+   inline void pack( Stream& s, const eosio::chain::shared_vector<T>& vec ) {
+      fc::raw::pack( s, unsigned_int((uint32_t)vec.size()) );
+      for( const auto& v : vec )
+         fc::raw::pack( s, v );
+   }
+
+   template<typename Stream, typename T>
+   inline void unpack( Stream& s, eosio::chain::shared_vector<T>& vec ) {
+      unsigned_int size;
+      fc::raw::unpack( s, size );
+      vec.clear();
+      vec.reserve( size.value );
+      for( uint32_t i = 0; i < size.value; ++i ) {
+         T v;
+         fc::raw::unpack( s, v );
+         vec.emplace_back( std::move(v) );
+      }
+   }
+
+   template<typename Stream>
+   inline void pack( Stream& s, const float64_t& v ) {
+      fc::raw::pack( s, v.v );
+   }
+
+   template<typename Stream>
+   inline void unpack( Stream& s, float64_t& v ) {
+      fc::raw::unpack( s, v.v );
+   }
+
+   template<typename Stream>
+   inline void pack( Stream& s, const float128_t& v ) {
+      fc::raw::pack( s, v.v[0] );
+      fc::raw::pack( s, v.v[1] );
+   }
+
+   template<typename Stream>
+   inline void unpack( Stream& s, float128_t& v ) {
+      fc::raw::unpack( s, v.v[0] );
+      fc::raw::unpack( s, v.v[1] );
+   }
+
+   template<typename Stream>
+   inline void pack( Stream& s, const std::array<eosio::chain::uint128_t, 2>& v ) {
+      fc::raw::pack( s, v[0] );
+      fc::raw::pack( s, v[1] );
+   }
+
+   template<typename Stream>
+   inline void unpack( Stream& s, std::array<eosio::chain::uint128_t, 2>& v ) {
+      fc::raw::unpack( s, v[0] );
+      fc::raw::unpack( s, v[1] );
+   }
+
+} } // fc::raw
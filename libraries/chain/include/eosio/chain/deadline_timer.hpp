@@ -0,0 +1,43 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <fc/time.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Sets expired once the time it was started with has passed. A thread waits for the deadline,
+    * so code that polls for it in a loop (checktime on every loop iteration of a contract) reads an
+    * atomic flag instead of the clock.
+    */
+   class deadline_timer {
+      public:
+         deadline_timer();
+         ~deadline_timer();
+
+         /// clears expired and arms the timer, a deadline of fc::time_point::maximum() never expires
+         void start( fc::time_point deadline );
+         /// clears expired and disarms the timer
+         void stop();
+
+         std::atomic_bool expired{false};
+
+      private:
+         void run();
+
+         std::mutex               mtx;
+         std::condition_variable  cv;
+         fc::time_point           armed_deadline = fc::time_point::maximum();
+         bool                     shutdown = false;
+         std::thread              thread;
+   };
+
+} } // eosio::chain
@@ -95,6 +95,7 @@ namespace eosio { namespace chain {
     *   |- resource_limit_exception
     *   |- mongo_db_exception
     *   |- contract_api_exception
+    *   |- snapshot_exception
     */
 
     FC_DECLARE_DERIVED_EXCEPTION( chain_type_exception, chain_exception,
@@ -504,4 +505,15 @@ namespace eosio { namespace chain {
                                     3230002, "Database API Exception" )
       FC_DECLARE_DERIVED_EXCEPTION( arithmetic_exception,   contract_api_exception,
                                     3230003, "Arithmetic Exception" )
+
+   FC_DECLARE_DERIVED_EXCEPTION( snapshot_exception,    chain_exception,
+                                 3240000, "Snapshot exception" )
+      FC_DECLARE_DERIVED_EXCEPTION( snapshot_validation_exception,   snapshot_exception,
+                                    3240001, "Snapshot Validation Exception" )
+      FC_DECLARE_DERIVED_EXCEPTION( snapshot_section_not_found,   snapshot_exception,
+                                    3240002, "Snapshot section can not be found" )
+      FC_DECLARE_DERIVED_EXCEPTION( snapshot_directory_not_found_exception,   snapshot_exception,
+                                    3240003, "Snapshot directory not found" )
+      FC_DECLARE_DERIVED_EXCEPTION( snapshot_exists_exception,   snapshot_exception,
+                                    3240004, "Snapshot already exists" )
 } } // eosio::chain
@@ -78,9 +78,9 @@ CHAINBASE_SET_INDEX_TYPE(eosio::chain::dynamic_global_property_object,
                          eosio::chain::dynamic_global_property_multi_index)
 
 FC_REFLECT(eosio::chain::dynamic_global_property_object,
-           (global_action_sequence)
+           (id)(global_action_sequence)
           )
 
 FC_REFLECT(eosio::chain::global_property_object,
-           (proposed_schedule_block_num)(proposed_schedule)(configuration)
+           (id)(proposed_schedule_block_num)(proposed_schedule)(configuration)
           )
@@ -4,7 +4,12 @@
 #include <chainbase/chainbase.hpp>
 #include <set>
 
-namespace eosio { namespace chain { namespace resource_limits {
+namespace eosio { namespace chain {
+
+   class snapshot_writer;
+   class snapshot_reader;
+
+namespace resource_limits {
    namespace impl {
       template<typename T>
       struct ratio {
@@ -43,6 +48,8 @@ namespace eosio { namespace chain { namespace resource_limits {
 
          void add_indices();
          void initialize_database();
+         void add_to_snapshot( snapshot_writer& snapshot )const;
+         void read_from_snapshot( snapshot_reader& snapshot );
          void initialize_account( const account_name& account );
          void set_block_parameters( const elastic_limit_parameters& cpu_limit_parameters, const elastic_limit_parameters& net_limit_parameters );
 
@@ -80,3 +87,5 @@ namespace eosio { namespace chain { namespace resource_limits {
 } } } /// eosio::chain
 
 FC_REFLECT( eosio::chain::resource_limits::account_resource_limit, (used)(available)(max) )
+FC_REFLECT( eosio::chain::resource_limits::ratio, (numerator)(denominator))
+FC_REFLECT( eosio::chain::resource_limits::elastic_limit_parameters, (target)(max)(periods)(max_multiplier)(contract_rate)(expand_rate))
@@ -0,0 +1,247 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/database_utils.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/datastream.hpp>
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace eosio { namespace chain {
+
+   /**
+    * A snapshot is a portable image of the chain state at a head block. It holds the head block state
+    * and every row of every chainbase index, and it does not depend on the layout of shared_memory.bin
+    * or on the binary that wrote it.
+    *
+    * Layout of the stream:
+    *
+    * +--------------+---------+-----------+-----+-----------+--------------------+
+    * | magic number | version | section 1 | ... | section N | 0xffffffffffffffff |
+    * +--------------+---------+-----------+-----+-----------+--------------------+
+    *
+    * where every section is
+    *
+    * +----------------------+-----------+-------------------+-------------+
+    * | section size (bytes) | row count | section name '\0' | packed rows |
+    * +----------------------+-----------+-------------------+-------------+
+    *
+    * The section size does not include its own 8 bytes, so a reader can hop from section to section
+    * to find one by name. Rows are written one at a time, so a snapshot never has to fit in memory.
+    */
+   struct snapshot_header {
+      static constexpr uint32_t magic_number = 0x30510550;
+
+      /**
+       * History:
+       * Version 1: initial version
+       * Version 2: sections are named by EOSIO_SNAPSHOT_SECTION instead of the compiler's demangled type name
+       */
+      static constexpr uint32_t current_version = 2;
+   };
+
+   namespace detail {
+      /**
+       * Section names are part of the snapshot format, so every row type names its section explicitly with
+       * EOSIO_SNAPSHOT_SECTION; a type without a name does not compile.
+       */
+      template<typename T>
+      struct snapshot_section_traits;
+   }
+
+   class snapshot_writer {
+      public:
+         explicit snapshot_writer( std::ostream& snapshot );
+
+         class section_writer {
+            public:
+               template<typename T>
+               void add_row( const T& row ) {
+                  _writer.write_row( row );
+               }
+
+            private:
+               friend class snapshot_writer;
+               explicit section_writer( snapshot_writer& writer )
+               :_writer(writer) {}
+
+               snapshot_writer& _writer;
+         };
+
+         template<typename F>
+         void write_section( const std::string& section_name, F&& f ) {
+            write_start_section( section_name );
+            section_writer section( *this );
+            f( section );
+            write_end_section();
+         }
+
+         template<typename T, typename F>
+         void write_section( F&& f ) {
+            write_section( detail::snapshot_section_traits<T>::section_name(), std::forward<F>(f) );
+         }
+
+         /// writes the end marker, the snapshot is incomplete until this is called
+         void finalize();
+
+      private:
+         template<typename T>
+         void write_row( const T& row ) {
+            row_buffer.resize( fc::raw::pack_size( row ) );
+            fc::datastream<char*> ds( row_buffer.data(), row_buffer.size() );
+            fc::raw::pack( ds, row );
+            snapshot.write( row_buffer.data(), row_buffer.size() );
+            ++row_count;
+         }
+
+         void write_start_section( const std::string& section_name );
+         void write_end_section();
+
+         std::ostream&   snapshot;
+         std::streampos  section_pos = -1;
+         uint64_t        row_count = 0;
+         vector<char>    row_buffer;
+   };
+
+   class snapshot_reader {
+      public:
+         explicit snapshot_reader( std::istream& snapshot );
+
+         class section_reader {
+            public:
+               template<typename T>
+               void read_row( T& out ) {
+                  EOS_ASSERT( _remaining > 0, snapshot_exception, "Attempt to read past the end of a snapshot section" );
+                  --_remaining;
+                  fc::raw::unpack( _reader.snapshot, out );
+               }
+
+               bool     empty()const     { return _remaining == 0; }
+               uint64_t remaining()const { return _remaining; }
+
+            private:
+               friend class snapshot_reader;
+               section_reader( snapshot_reader& reader, uint64_t row_count )
+               :_reader(reader), _remaining(row_count) {}
+
+               snapshot_reader& _reader;
+               uint64_t         _remaining;
+         };
+
+         /// checks the header and that every section is complete, throws snapshot_validation_exception otherwise
+         void validate();
+
+         bool has_section( const std::string& section_name );
+
+         template<typename F>
+         void read_section( const std::string& section_name, F&& f ) {
+            section_reader section( *this, set_section( section_name ) );
+            f( section );
+            EOS_ASSERT( section.empty(), snapshot_validation_exception,
+                        "Snapshot section ${name} has ${n} unread rows", ("name", section_name)("n", section.remaining()) );
+         }
+
+         template<typename T, typename F>
+         void read_section( F&& f ) {
+            read_section( detail::snapshot_section_traits<T>::section_name(), std::forward<F>(f) );
+         }
+
+      private:
+         /// positions the stream at the first row of the section and returns its row count
+         uint64_t set_section( const std::string& section_name );
+
+         std::istream&   snapshot;
+         std::streampos  header_pos;
+   };
+
+   using snapshot_writer_ptr = std::shared_ptr<snapshot_writer>;
+   using snapshot_reader_ptr = std::shared_ptr<snapshot_reader>;
+
+   /**
+    * Maps the ids a snapshot was written with to the ids chainbase assigns when the rows are recreated.
+    * Rows are read back in id order, so the old ids are added in ascending order and can be binary searched.
+    */
+   template<typename IdType>
+   class snapshot_id_map {
+      public:
+         void add( IdType old_id, IdType new_id ) {
+            _ids.emplace_back( old_id, new_id );
+         }
+
+         IdType operator()( IdType old_id )const {
+            auto itr = std::lower_bound( _ids.begin(), _ids.end(), old_id,
+                                         []( const std::pair<IdType,IdType>& e, const IdType& id ) { return e.first < id; } );
+            EOS_ASSERT( itr != _ids.end() && itr->first == old_id, snapshot_validation_exception,
+                        "Snapshot row references unknown id ${id}", ("id", old_id._id) );
+            return itr->second;
+         }
+
+      private:
+         vector<std::pair<IdType,IdType>> _ids;
+   };
+
+   /**
+    * Writes every row of the index, in id order, as a section named after the row type.
+    */
+   template<typename Index>
+   void add_index_to_snapshot( snapshot_writer& snapshot, const chainbase::database& db ) {
+      using value_t = typename index_utils<Index>::value_type;
+      snapshot.write_section<value_t>( [&db]( auto& section ) {
+         index_utils<Index>::walk( db, [&section]( const value_t& row ) {
+            section.add_row( row );
+         });
+      });
+   }
+
+   /**
+    * Recreates every row of the index from its section. chainbase assigns fresh ids, so on_row is called with
+    * the new row and the id it was written with, before the row is inserted, to record or remap references.
+    */
+   template<typename Index, typename F>
+   void read_index_from_snapshot( snapshot_reader& snapshot, chainbase::database& db, F&& on_row ) {
+      using value_t = typename index_utils<Index>::value_type;
+      snapshot.read_section<value_t>( [&]( auto& section ) {
+         while( !section.empty() ) {
+            index_utils<Index>::create( db, [&]( value_t& row ) {
+               auto new_id = row.id;
+               section.read_row( row );
+               auto old_id = row.id;
+               row.id = new_id;
+               on_row( row, old_id );
+            });
+         }
+      });
+   }
+
+   template<typename Index>
+   void read_index_from_snapshot( snapshot_reader& snapshot, chainbase::database& db ) {
+      read_index_from_snapshot<Index>( snapshot, db, []( auto&, auto ) {} );
+   }
+
+} } // eosio::chain
+
+/**
+ * Gives the snapshot section holding rows of TYPE the stable name NAME. Must be used at global scope,
+ * before the first snapshot of TYPE is written or read in the translation unit.
+ */
+#define EOSIO_SNAPSHOT_SECTION( TYPE, NAME ) \
+namespace eosio { namespace chain { namespace detail { \
+   template<> \
+   struct snapshot_section_traits<TYPE> { \
+      static std::string section_name() { return NAME; } \
+   }; \
+} } }
+
+namespace eosio { namespace chain {
+   struct genesis_state;
+   struct block_state;
+} }
+
+EOSIO_SNAPSHOT_SECTION( eosio::chain::genesis_state, "eosio::chain::genesis_state" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::block_state,   "eosio::chain::block_state" )
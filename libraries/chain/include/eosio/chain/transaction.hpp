@@ -102,6 +102,10 @@ namespace eosio { namespace chain {
       };
 
       packed_transaction() = default;
+      packed_transaction( const packed_transaction& other );
+      packed_transaction( packed_transaction&& other ) = default;
+      packed_transaction& operator=( const packed_transaction& other );
+      packed_transaction& operator=( packed_transaction&& other ) = default;
 
       explicit packed_transaction(const transaction& t, compression_type _compression = none)
       {
@@ -134,14 +138,23 @@ namespace eosio { namespace chain {
       transaction_id_type id()const;
       bytes              get_raw_transaction()const;
       vector<bytes>      get_context_free_data()const;
-      transaction        get_transaction()const;
+      const transaction& get_transaction()const;
       signed_transaction get_signed_transaction()const;
       void               set_transaction(const transaction& t, compression_type _compression = none);
       void               set_transaction(const transaction& t, const vector<bytes>& cfd, compression_type _compression = none);
 
    private:
-      mutable optional<transaction>           unpacked_trx; // <-- intermediate buffer used to retrieve values
-      void local_unpack()const;
+      struct unpacked {
+         transaction          trx;
+         transaction_id_type  id;
+      };
+
+      /**
+       * decoded on first use and shared by copies, so a transaction copied into blocks and queues is decoded and
+       * hashed once; const members can run on several threads at once, so it is only read and published atomically
+       */
+      mutable std::shared_ptr<const unpacked> unpacked_trx;
+      const unpacked& local_unpack()const;
    };
 
    using packed_transaction_ptr = std::shared_ptr<packed_transaction>;
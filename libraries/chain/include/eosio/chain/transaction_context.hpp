@@ -1,9 +1,21 @@
 #pragma once
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
+#include <eosio/chain/deadline_timer.hpp>
+#include <sstream>
 
 namespace eosio { namespace chain {
 
+   /**
+    * Queues an apply_context fills while its action runs. transaction_context keeps the ones of finished
+    * actions and hands them, empty, to the next apply_context, so the actions of a transaction reuse their capacity.
+    */
+   struct apply_context_buffers {
+      vector<account_name> notified;           ///< keeps track of new accounts to be notifed of current message
+      vector<action>       inline_actions;     ///< queued inline messages
+      vector<action>       cfa_inline_actions; ///< queued context free inline messages
+   };
+
    class transaction_context {
       private:
          void init( uint64_t initial_net_usage);
@@ -14,6 +26,7 @@ namespace eosio { namespace chain {
                               const signed_transaction& t,
                               const transaction_id_type& trx_id,
                               fc::time_point start = fc::time_point::now() );
+         ~transaction_context();
 
          void init_for_implicit_trx( uint64_t initial_net_usage = 0 );
 
@@ -57,6 +70,9 @@ namespace eosio { namespace chain {
 
          void validate_cpu_usage_to_bill( int64_t u, bool check_minimum = true )const;
 
+         apply_context_buffers take_apply_buffers();
+         void                  return_apply_buffers( apply_context_buffers&& buffers );
+
       /// Fields:
       public:
 
@@ -105,6 +121,11 @@ namespace eosio { namespace chain {
          fc::time_point                pseudo_start;
          fc::microseconds              billed_time;
          fc::microseconds              billing_timer_duration_limit;
+         deadline_timer&               _deadline_timer; ///< expires at _deadline, so checktime only reads the clock once it has
+
+         vector<apply_context_buffers> _spare_apply_buffers;
+         /// console output of the action being applied, apply_context clears it after each action so one stream serves the transaction
+         std::ostringstream            _console_stream;
    };
 
 } }
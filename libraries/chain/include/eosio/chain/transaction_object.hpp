@@ -51,3 +51,5 @@ namespace eosio { namespace chain {
 
 CHAINBASE_SET_INDEX_TYPE(eosio::chain::transaction_object, eosio::chain::transaction_multi_index)
 
+FC_REFLECT(eosio::chain::transaction_object, (id)(expiration)(trx_id))
+
@@ -0,0 +1,126 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/transaction_metadata.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Transactions that were undone by pop_block or abort_block and wait to be applied again, indexed by signed id,
+    * transaction id, expiration, arrival order and payer (the first authorizer).
+    *
+    * Producers walk the queue in arrival order with a cursor (see next), which stays valid while the transactions
+    * it returns are applied or dropped, so nothing is copied when a block is started.
+    */
+   class unapplied_transaction_queue {
+      public:
+         struct entry {
+            transaction_metadata_ptr trx;
+            time_point_sec           expiration;
+            account_name             payer;
+            uint64_t                 sequence = 0;  ///< arrival order
+            fc::time_point           added;
+
+            const digest_type&         signed_id()const { return trx->signed_id; }
+            const transaction_id_type& id()const        { return trx->id; }
+         };
+
+         struct by_signed_id;
+         struct by_trx_id;
+         struct by_expiry;
+         struct by_arrival;
+         struct by_payer;
+
+         typedef boost::multi_index::multi_index_container<
+            entry,
+            boost::multi_index::indexed_by<
+               boost::multi_index::hashed_unique< boost::multi_index::tag<by_signed_id>,
+                  boost::multi_index::const_mem_fun<entry, const digest_type&, &entry::signed_id>, std::hash<digest_type> >,
+               boost::multi_index::hashed_non_unique< boost::multi_index::tag<by_trx_id>,
+                  boost::multi_index::const_mem_fun<entry, const transaction_id_type&, &entry::id>, std::hash<transaction_id_type> >,
+               boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_expiry>,
+                  boost::multi_index::member<entry, time_point_sec, &entry::expiration> >,
+               boost::multi_index::ordered_unique< boost::multi_index::tag<by_arrival>,
+                  boost::multi_index::member<entry, uint64_t, &entry::sequence> >,
+               boost::multi_index::ordered_unique< boost::multi_index::tag<by_payer>,
+                  boost::multi_index::composite_key< entry,
+                     boost::multi_index::member<entry, account_name, &entry::payer>,
+                     boost::multi_index::member<entry, uint64_t, &entry::sequence>
+                  >
+               >
+            >
+         > index_type;
+
+         /// does nothing if a transaction with the same signed id is already queued
+         void add( const transaction_metadata_ptr& trx ) {
+            entry e;
+            e.trx        = trx;
+            e.expiration = trx->trx.expiration;
+            e.payer      = trx->trx.first_authorizor();
+            e.sequence   = next_sequence++;
+            e.added      = fc::time_point::now();
+            queue.insert( std::move(e) );
+         }
+
+         bool erase( const digest_type& signed_id ) {
+            return queue.get<by_signed_id>().erase( signed_id ) > 0;
+         }
+
+         /// drops the transactions that expire before `now`, they can no longer be applied
+         size_t erase_expired( const fc::time_point& now ) {
+            auto& by_exp = queue.get<by_expiry>();
+            size_t erased = 0;
+            while( !by_exp.empty() && by_exp.begin()->expiration.to_time_point() < now ) {
+               by_exp.erase( by_exp.begin() );
+               ++erased;
+            }
+            return erased;
+         }
+
+         void clear() { queue.clear(); }
+
+         /**
+          * Returns the first transaction that arrived at or after `cursor` and moves the cursor past it, or null when
+          * there are no more. Transactions may be added and erased between calls.
+          */
+         transaction_metadata_ptr next( uint64_t& cursor )const {
+            const auto& by_seq = queue.get<by_arrival>();
+            auto itr = by_seq.lower_bound( cursor );
+            if( itr == by_seq.end() )
+               return transaction_metadata_ptr();
+            cursor = itr->sequence + 1;
+            return itr->trx;
+         }
+
+         bool   contains( const digest_type& signed_id )const { return queue.get<by_signed_id>().count( signed_id ) > 0; }
+         size_t size()const                                   { return queue.size(); }
+         bool   empty()const                                  { return queue.empty(); }
+         size_t count_by_payer( account_name payer )const {
+            auto range = queue.get<by_payer>().equal_range( boost::make_tuple( payer ) );
+            return std::distance( range.first, range.second );
+         }
+
+         /// when the longest waiting transaction was queued, time_point() if the queue is empty
+         fc::time_point oldest_arrival()const {
+            const auto& by_seq = queue.get<by_arrival>();
+            return by_seq.empty() ? fc::time_point() : by_seq.begin()->added;
+         }
+
+         const index_type& index()const { return queue; }
+
+      private:
+         index_type queue;
+         uint64_t   next_sequence = 0;
+   };
+
+} } // eosio::chain
@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <fc/filesystem.hpp>
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 
@@ -56,15 +57,46 @@ namespace eosio { namespace chain {
             binaryen,
          };
 
-         wasm_interface(vm_type vm);
+         /**
+          * Bounds of the instantiated contracts kept in memory. When either is exceeded the least recently
+          * used contracts are released; contracts of privileged accounts are never released. 0 is unbounded.
+          */
+         struct cache_limits {
+            uint32_t max_entries   = 0;
+            uint64_t max_code_size = 0;  ///< sum of the contract sizes, a proxy for the memory of their jitted code
+         };
+
+         struct cache_stats {
+            uint64_t hits          = 0;  ///< applied without compiling, a compile started earlier in the background included
+            uint64_t misses        = 0;  ///< compiled when applied
+            uint64_t evictions     = 0;
+            uint32_t entries       = 0;
+            uint32_t pinned        = 0;
+            uint64_t code_size     = 0;
+            uint64_t compiles      = 0;  ///< contracts prepared and instantiated, background compiles included
+            uint64_t compile_time  = 0;  ///< microseconds spent preparing and instantiating, background compiles included
+         };
+
+         /**
+          * @param code_cache_dir  where contracts are kept after the injection pass, so that a restarted node
+          *                        compiles the contracts it has run before at startup instead of on the first
+          *                        transaction that uses them; an empty path disables the cache
+          */
+         wasm_interface(vm_type vm, const fc::path& code_cache_dir = fc::path(), const cache_limits& limits = cache_limits());
          ~wasm_interface();
 
          //validates code -- does a WASM validation pass and checks the wasm against EOSIO specific constraints
          static void validate(const controller& control, const bytes& code);
 
+         //Starts preparing and instantiating code on a background thread; apply waits for it if it gets there first.
+         //The result joins the instantiation cache and its limits. Nothing is started while too many compiles are pending
+         void compile_async(const digest_type& code_id, const bytes& code);
+
          //Calls apply or error on a given code
          void apply(const digest_type& code_id, const shared_string& code, apply_context& context);
 
+         cache_stats get_cache_stats()const;
+
       private:
          unique_ptr<struct wasm_interface_impl> my;
          friend class eosio::chain::webassembly::common::intrinsics_accessor;
@@ -77,3 +109,5 @@ namespace eosio{ namespace chain {
 }}
 
 FC_REFLECT_ENUM( eosio::chain::wasm_interface::vm_type, (wavm)(binaryen) )
+FC_REFLECT( eosio::chain::wasm_interface::cache_limits, (max_entries)(max_code_size) )
+FC_REFLECT( eosio::chain::wasm_interface::cache_stats, (hits)(misses)(evictions)(entries)(pinned)(code_size)(compiles)(compile_time) )
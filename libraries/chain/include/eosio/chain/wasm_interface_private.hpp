@@ -6,8 +6,24 @@
 #include <eosio/chain/webassembly/runtime_interface.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
 #include <eosio/chain/transaction_context.hpp>
+#include <eosio/chain/apply_context.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/filesystem.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <mutex>
 
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
@@ -22,17 +38,225 @@ using namespace Runtime;
 
 namespace eosio { namespace chain {
 
+   /**
+    * A contract after the injection pass, as stored in the code cache directory (one file per code_id).
+    * The native code the runtimes generate holds addresses of the running process, so it is not stored;
+    * keeping the injected module lets startup go straight to instantiation.
+    *
+    * An entry is only used by the runtime and the build that wrote it, and only if its checksum matches,
+    * since it is executed without running the injection pass again.
+    */
+   struct cached_code {
+      /**
+       * History:
+       * Version 1: initial version
+       * Version 2: runtime, build_id and checksum added to the header
+       */
+      static constexpr uint32_t magic_number = 0xc0dec0de;
+      static constexpr uint32_t current_version = 2;
+
+      /// version, source revision and a hash of the injection sources of this build, generated by cmake (wasm_interface_build.cpp.in)
+      static const string build_id;
+
+      digest_type          code_id;
+      std::vector<uint8_t> code;
+      std::vector<uint8_t> initial_memory;
+   };
+
+   struct instantiated_code {
+      digest_type                                         code_id;
+      std::shared_ptr<wasm_instantiated_module_interface> module;
+      size_t                                              code_size = 0;
+      bool                                                pinned = false;
+      bool                                                applied = true;  ///< false until a compiled ahead contract runs
+   };
+
+   struct by_code_id;
+   typedef boost::multi_index::multi_index_container<
+      instantiated_code,
+      boost::multi_index::indexed_by<
+         boost::multi_index::sequenced<>, // most recently used first
+         boost::multi_index::ordered_unique< boost::multi_index::tag<by_code_id>,
+            boost::multi_index::member<instantiated_code, digest_type, &instantiated_code::code_id> >
+      >
+   > instantiation_cache_index;
+
    struct wasm_interface_impl {
-      wasm_interface_impl(wasm_interface::vm_type vm) {
+      using instantiated_module_ptr = std::unique_ptr<wasm_instantiated_module_interface>;
+
+      struct pending_compile {
+         std::future<instantiated_module_ptr> module;
+         size_t                               code_size = 0;
+      };
+
+      /// background compiles queued or not yet taken into the instantiation cache, beyond it compile_async does nothing
+      static constexpr uint32_t max_pending_compiles = 64;
+
+      wasm_interface_impl(wasm_interface::vm_type vm, const fc::path& code_cache_dir, const wasm_interface::cache_limits& limits)
+      :code_cache_dir(code_cache_dir)
+      ,vm(vm)
+      ,limits(limits)
+      ,compile_pool(1)
+      {
          if(vm == wasm_interface::vm_type::wavm)
             runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
          else if(vm == wasm_interface::vm_type::binaryen)
             runtime_interface = std::make_unique<webassembly::binaryen::binaryen_runtime>();
          else
             EOS_THROW(wasm_exception, "wasm_interface_impl fall through");
+
+         load_code_cache();
+      }
+
+      ~wasm_interface_impl() {
+         // drop queued compiles and wait for the running one, it uses the runtime
+         compile_pool.stop();
+         compile_pool.join();
+      }
+
+      fc::path code_cache_file(const digest_type& code_id)const {
+         return code_cache_dir / (code_id.str() + ".bin");
+      }
+
+      static digest_type checksum( const cached_code& entry ) {
+         digest_type::encoder enc;
+         fc::raw::pack(enc, entry.code_id);
+         fc::raw::pack(enc, entry.code);
+         fc::raw::pack(enc, entry.initial_memory);
+         return enc.result();
+      }
+
+      /**
+       * Queues the most recently used entries for instantiation, as many as the cache limits hold; older
+       * entries, entries of another runtime or build and damaged ones are removed.
+       */
+      void load_code_cache() {
+         if( code_cache_dir.empty() )
+            return;
+         if( !fc::is_directory(code_cache_dir) ) {
+            fc::create_directories(code_cache_dir);
+            return;
+         }
+
+         vector<pair<std::time_t, fc::path>> files;
+         for( fc::directory_iterator itr(code_cache_dir), end; itr != end; ++itr ) {
+            const fc::path file = *itr;
+            const auto extension = file.extension().string();
+            if( extension == ".tmp" ) {
+               fc::remove(file);
+            } else if( extension == ".bin" ) {
+               boost::system::error_code ec;
+               const auto written = boost::filesystem::last_write_time(file.generic_string(), ec);
+               files.emplace_back(ec ? std::time_t(0) : written, file);
+            }
+         }
+         std::sort(files.begin(), files.end(), []( const auto& a, const auto& b ) { return a.first > b.first; });
+
+         uint32_t loaded = 0;
+         uint32_t pruned = 0;
+         uint64_t code_size = 0;
+         for( const auto& f : files ) {
+            const fc::path& file = f.second;
+            if( (limits.max_entries && loaded >= limits.max_entries) ||
+                (limits.max_code_size && code_size >= limits.max_code_size) ) {
+               fc::remove(file);
+               ++pruned;
+               continue;
+            }
+            try {
+               std::ifstream in(file.generic_string(), std::ios::in | std::ios::binary);
+               in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+               uint32_t magic_number = 0;
+               uint32_t version = 0;
+               fc::raw::unpack(in, magic_number);
+               fc::raw::unpack(in, version);
+               uint8_t runtime = 0;
+               string build_id;
+               if( magic_number == cached_code::magic_number && version == cached_code::current_version ) {
+                  fc::raw::unpack(in, runtime);
+                  fc::raw::unpack(in, build_id);
+               }
+               if( magic_number != cached_code::magic_number || version != cached_code::current_version ||
+                   runtime != static_cast<uint8_t>(vm) || build_id != cached_code::build_id ) {
+                  in.close();
+                  fc::remove(file);
+                  ++pruned;
+                  continue;
+               }
+               digest_type expected;
+               cached_code entry;
+               fc::raw::unpack(in, expected);
+               fc::raw::unpack(in, entry.code_id);
+               fc::raw::unpack(in, entry.code);
+               fc::raw::unpack(in, entry.initial_memory);
+               in.close();
+               EOS_ASSERT( checksum(entry) == expected, wasm_exception, "code cache entry is damaged" );
+               EOS_ASSERT( code_cache_file(entry.code_id) == file, wasm_exception, "code cache entry does not match its file name" );
+
+               // the size after injection, the contract itself is not read here
+               const auto entry_size = entry.code.size();
+               code_size += entry_size;
+               const auto code_id = entry.code_id;
+               compiling.emplace(code_id, pending_compile{ async_thread_pool(compile_pool, [this, file, entry = std::move(entry)]() {
+                  try {
+                     return instantiate(entry);
+                  } catch( ... ) {
+                     fc::remove(file);
+                     throw;
+                  }
+               }), entry_size });
+               ++loaded;
+            } catch( const fc::exception& e ) {
+               wlog("discarding unreadable code cache entry ${f}: ${e}", ("f", file.generic_string())("e", e.to_detail_string()));
+               fc::remove(file);
+            } catch( const std::exception& e ) {
+               wlog("discarding unreadable code cache entry ${f}: ${e}", ("f", file.generic_string())("e", e.what()));
+               fc::remove(file);
+            }
+         }
+         if( loaded || pruned )
+            ilog("instantiating ${n} contracts from the code cache, ${p} stale or unused entries removed", ("n", loaded)("p", pruned));
+      }
+
+      /// marks an entry as used, load_code_cache keeps the most recently used ones
+      void touch_code_cache( const digest_type& code_id ) {
+         if( code_cache_dir.empty() )
+            return;
+         boost::system::error_code ec;
+         boost::filesystem::last_write_time(code_cache_file(code_id).generic_string(), std::time(nullptr), ec);
+      }
+
+      /// failing to write the cache only costs a recompile after the next restart, so it is not an error
+      void store_code_cache(const cached_code& entry) {
+         if( code_cache_dir.empty() )
+            return;
+         const auto file = code_cache_file(entry.code_id);
+         const auto tmp = file.generic_string() + ".tmp";
+         try {
+            {
+               std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+               out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+               const uint32_t magic_number = cached_code::magic_number;
+               const uint32_t version = cached_code::current_version;
+               const uint8_t runtime = static_cast<uint8_t>(vm);
+               fc::raw::pack(out, magic_number);
+               fc::raw::pack(out, version);
+               fc::raw::pack(out, runtime);
+               fc::raw::pack(out, cached_code::build_id);
+               fc::raw::pack(out, checksum(entry));
+               fc::raw::pack(out, entry.code_id);
+               fc::raw::pack(out, entry.code);
+               fc::raw::pack(out, entry.initial_memory);
+            }
+            fc::rename(tmp, file);
+         } catch( const fc::exception& e ) {
+            wlog("unable to write code cache entry ${f}: ${e}", ("f", file.generic_string())("e", e.to_detail_string()));
+         } catch( const std::exception& e ) {
+            wlog("unable to write code cache entry ${f}: ${e}", ("f", file.generic_string())("e", e.what()));
+         }
       }
 
-      std::vector<uint8_t> parse_initial_memory(const Module& module) {
+      static std::vector<uint8_t> parse_initial_memory(const Module& module) {
          std::vector<uint8_t> mem_image;
 
          for(const DataSegment& data_segment : module.dataSegments) {
@@ -50,47 +274,230 @@ namespace eosio { namespace chain {
          return mem_image;
       }
 
-      std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_id,
-                                                                                    const shared_string& code,
-                                                                                    transaction_context& trx_context )
+      /// deserializes and injects the contract; only call with compile_mutex held, the injection pass keeps static state
+      static cached_code prepare_code( const digest_type& code_id, const char* code, size_t code_size ) {
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code, code_size);
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         wasm_injections::wasm_binary_injection injector(module);
+         injector.inject();
+
+         cached_code entry;
+         entry.code_id = code_id;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            entry.code = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+         entry.initial_memory = parse_initial_memory(module);
+         return entry;
+      }
+
+      instantiated_module_ptr instantiate( const cached_code& entry ) {
+         std::lock_guard<std::mutex> g(compile_mutex);
+         return runtime_interface->instantiate_module((const char*)entry.code.data(), entry.code.size(), entry.initial_memory);
+      }
+
+      instantiated_module_ptr compile( const digest_type& code_id, const char* code, size_t code_size ) {
+         const auto start = fc::time_point::now();
+         auto record_time = fc::make_scoped_exit([&](){
+            ++compiles;
+            compile_time += (fc::time_point::now() - start).count();
+         });
+         cached_code entry;
+         {
+            std::lock_guard<std::mutex> g(compile_mutex);
+            entry = prepare_code(code_id, code, code_size);
+         }
+         auto module = instantiate(entry);
+         store_code_cache(entry);
+         return module;
+      }
+
+      bool should_compile( const digest_type& code_id )const {
+         return !instantiation_cache.get<by_code_id>().count(code_id) && !compiling.count(code_id)
+             && compiling.size() < max_pending_compiles;
+      }
+
+      void queue_compile( const digest_type& code_id, bytes code ) {
+         const auto code_size = code.size();
+         compiling.emplace(code_id, pending_compile{ async_thread_pool(compile_pool, [this, code_id, code = std::move(code)]() {
+            return compile(code_id, code.data(), code.size());
+         }), code_size });
+      }
+
+      void compile_async( const digest_type& code_id, const bytes& code ) {
+         take_compiled();
+         if( should_compile(code_id) )
+            queue_compile(code_id, code);
+      }
+
+      /**
+       * Moves finished background compiles into the instantiation cache, behind the contracts that have run, so
+       * they are bounded by its limits whether or not they ever run: the setcode may fail, the code may be replaced
+       * before it runs, or a code cache entry may belong to a contract no longer used.
+       */
+      void take_compiled() {
+         auto& by_id = instantiation_cache.get<by_code_id>();
+         bool taken = false;
+         for( auto itr = compiling.begin(); itr != compiling.end(); ) {
+            if( itr->second.module.wait_for(std::chrono::seconds(0)) != std::future_status::ready ) {
+               ++itr;
+               continue;
+            }
+            instantiated_module_ptr module;
+            try {
+               module = itr->second.module.get();
+            } catch( ... ) {
+               // compiled again when applied, so that the error is reported against that transaction
+            }
+            if( module && !by_id.count(itr->first) ) {
+               instantiated_code entry;
+               entry.code_id = itr->first;
+               entry.module = std::move(module);
+               entry.code_size = itr->second.code_size;
+               entry.applied = false;
+               instantiation_cache.push_back(std::move(entry));
+               cached_code_size += itr->second.code_size;
+               taken = true;
+            }
+            itr = compiling.erase(itr);
+         }
+         if( taken )
+            evict();
+      }
+
+      std::shared_ptr<wasm_instantiated_module_interface> get_instantiated_module( const digest_type& code_id,
+                                                                                   const shared_string& code,
+                                                                                   apply_context& context )
       {
-         auto it = instantiation_cache.find(code_id);
-         if(it == instantiation_cache.end()) {
+         auto& by_id = instantiation_cache.get<by_code_id>();
+         auto it = by_id.find(code_id);
+         if( it != by_id.end() ) {
+            ++hits;
+            if( !it->applied )
+               touch_code_cache(code_id);
+            // setpriv may have changed since the contract was cached
+            if( it->pinned != context.privileged || !it->applied )
+               by_id.modify(it, [&]( auto& entry ) {
+                  entry.pinned = context.privileged;
+                  entry.applied = true;
+               });
+            instantiation_cache.relocate(instantiation_cache.begin(), instantiation_cache.project<0>(it));
+            return it->module;
+         }
+
+         {
+            auto& trx_context = context.trx_context;
             auto timer_pause = fc::make_scoped_exit([&](){
                trx_context.resume_billing_timer();
             });
             trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+
+            instantiated_module_ptr module;
+            auto pending = compiling.find(code_id);
+            if( pending != compiling.end() ) {
+               auto result = std::move(pending->second.module);
+               compiling.erase(pending);
+               try {
+                  module = result.get();
+                  touch_code_cache(code_id);
+               } catch( ... ) {
+                  // compiled again below, so that an error is reported against this contract and transaction
+               }
+            }
+            if( module ) {
+               ++hits;
+            } else {
+               ++misses;
+               module = compile(code_id, code.data(), code.size());
             }
 
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
+            instantiated_code entry;
+            entry.code_id = code_id;
+            entry.module = std::move(module);
+            entry.code_size = code.size();
+            entry.pinned = context.privileged;
+            instantiation_cache.push_front(std::move(entry));
+            cached_code_size += code.size();
+         }
+         auto result = instantiation_cache.front().module;
+         evict();
+         return result;
+      }
 
-            std::vector<U8> bytes;
-            try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
-            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module))).first;
+      /// releases least recently used contracts until the cache is within its limits, the most recent one is kept
+      void evict() {
+         auto over_limits = [&]() {
+            return (limits.max_entries && instantiation_cache.size() > limits.max_entries)
+                || (limits.max_code_size && cached_code_size > limits.max_code_size);
+         };
+         auto itr = instantiation_cache.end();
+         while( over_limits() && itr != instantiation_cache.begin() ) {
+            --itr;
+            if( itr == instantiation_cache.begin() )
+               break;
+            if( itr->pinned )
+               continue;
+            cached_code_size -= itr->code_size;
+            ++evictions;
+            itr = instantiation_cache.erase(itr);
          }
-         return it->second;
+      }
+
+      wasm_interface::cache_stats get_cache_stats()const {
+         wasm_interface::cache_stats stats;
+         stats.hits = hits;
+         stats.misses = misses;
+         stats.evictions = evictions;
+         stats.entries = instantiation_cache.size();
+         for( const auto& entry : instantiation_cache )
+            stats.pinned += entry.pinned;
+         stats.code_size = cached_code_size;
+         stats.compiles = compiles;
+         stats.compile_time = compile_time;
+         return stats;
       }
 
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
-      map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
+      fc::path code_cache_dir;
+      wasm_interface::vm_type vm;
+
+      /**
+       * Instantiated contracts in least recently used order. Releasing one frees its jitted code and
+       * instance, so the memory held is bounded by limits rather than by every contract ever run.
+       */
+      instantiation_cache_index     instantiation_cache;
+      wasm_interface::cache_limits  limits;
+      uint64_t                      cached_code_size = 0;
+      uint64_t                      hits = 0;
+      uint64_t                      misses = 0;
+      uint64_t                      evictions = 0;
+      std::atomic<uint64_t>         compiles{0};
+      std::atomic<uint64_t>         compile_time{0};
+
+      /**
+       * Contracts are prepared and instantiated on compile_pool as soon as they are set or found in the code
+       * cache at startup; apply only waits for a compile that has not finished yet. Finished compiles are moved
+       * into instantiation_cache by take_compiled. The injection pass and the runtimes' instantiation are not
+       * thread safe, so compile_mutex serializes them (and the pool has one thread); running already
+       * instantiated modules does not take it.
+       */
+      map<digest_type, pending_compile> compiling;
+      std::mutex                        compile_mutex;
+      boost::asio::thread_pool          compile_pool;
    };
 
 #define _REGISTER_INTRINSIC_EXPLICIT(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
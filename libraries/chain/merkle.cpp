@@ -1,6 +1,8 @@
 #include <eosio/chain/merkle.hpp>
 #include <fc/io/raw.hpp>
 
+#include <cstring>
+
 namespace eosio { namespace chain {
 
 /**
@@ -32,18 +34,34 @@ bool is_canonical_right(const digest_type& val) {
 }
 
 
+/**
+ * Same result as digest_type::hash(make_canonical_pair(l, r)): the serialized pair is the 64 raw bytes of
+ * both digests, so they are copied into one block and hashed directly instead of going through two digest
+ * copies and the datastream encoder. The canonical flag is the lowest byte of _hash[0], which is the first
+ * byte in memory.
+ */
+static digest_type hash_canonical_pair(const digest_type& l, const digest_type& r) {
+   static_assert( sizeof(digest_type) == 32, "merkle nodes are expected to be 32 byte digests" );
+   char pair[2 * sizeof(digest_type)];
+   memcpy( pair, l.data(), sizeof(digest_type) );
+   memcpy( pair + sizeof(digest_type), r.data(), sizeof(digest_type) );
+   pair[0] &= 0x7F;
+   pair[sizeof(digest_type)] |= 0x80;
+   return digest_type::hash( pair, sizeof(pair) );
+}
+
 digest_type merkle(vector<digest_type> ids) {
    if( 0 == ids.size() ) { return digest_type(); }
 
-   while( ids.size() > 1 ) {
-      if( ids.size() % 2 )
-         ids.push_back(ids.back());
-
-      for (int i = 0; i < ids.size() / 2; i++) {
-         ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+   // each level is hashed into the front of the same vector, an odd last node is paired with itself
+   size_t level = ids.size();
+   while( level > 1 ) {
+      const size_t parents = (level + 1) / 2;
+      for( size_t i = 0; i < parents; ++i ) {
+         const auto& left = ids[2 * i];
+         ids[i] = hash_canonical_pair( left, 2 * i + 1 < level ? ids[2 * i + 1] : left );
       }
-
-      ids.resize(ids.size() / 2);
+      level = parents;
    }
 
    return ids.front();
@@ -3,8 +3,15 @@
 #include <eosio/chain/resource_limits_private.hpp>
 #include <eosio/chain/transaction_metadata.hpp>
 #include <eosio/chain/transaction.hpp>
+#include <eosio/chain/database_utils.hpp>
+#include <eosio/chain/snapshot.hpp>
 #include <algorithm>
 
+EOSIO_SNAPSHOT_SECTION( eosio::chain::resource_limits::resource_limits_object,        "eosio::chain::resource_limits::resource_limits_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::resource_limits::resource_usage_object,         "eosio::chain::resource_limits::resource_usage_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::resource_limits::resource_limits_state_object,  "eosio::chain::resource_limits::resource_limits_state_object" )
+EOSIO_SNAPSHOT_SECTION( eosio::chain::resource_limits::resource_limits_config_object, "eosio::chain::resource_limits::resource_limits_config_object" )
+
 namespace eosio { namespace chain { namespace resource_limits {
 
 static_assert( config::rate_limiting_precision > 0, "config::rate_limiting_precision must be positive" );
@@ -38,11 +45,15 @@ void resource_limits_state_object::update_virtual_net_limit( const resource_limi
    virtual_net_limit = update_elastic_limit(virtual_net_limit, average_block_net_usage.average(), cfg.net_limit_parameters);
 }
 
+using resource_index_set = index_set<
+   resource_limits_index,
+   resource_usage_index,
+   resource_limits_state_index,
+   resource_limits_config_index
+>;
+
 void resource_limits_manager::add_indices() {
-   _db.add_index<resource_limits_index>();
-   _db.add_index<resource_usage_index>();
-   _db.add_index<resource_limits_state_index>();
-   _db.add_index<resource_limits_config_index>();
+   resource_index_set::add_indices(_db);
 }
 
 void resource_limits_manager::initialize_database() {
@@ -59,6 +70,18 @@ void resource_limits_manager::initialize_database() {
    });
 }
 
+void resource_limits_manager::add_to_snapshot( snapshot_writer& snapshot )const {
+   resource_index_set::walk_indices([this, &snapshot]( auto utils ){
+      add_index_to_snapshot<typename decltype(utils)::index_t>( snapshot, _db );
+   });
+}
+
+void resource_limits_manager::read_from_snapshot( snapshot_reader& snapshot ) {
+   resource_index_set::walk_indices([this, &snapshot]( auto utils ){
+      read_index_from_snapshot<typename decltype(utils)::index_t>( snapshot, _db );
+   });
+}
+
 void resource_limits_manager::initialize_account(const account_name& account) {
    _db.create<resource_limits_object>([&]( resource_limits_object& bl ) {
       bl.owner = account;
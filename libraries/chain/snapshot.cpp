@@ -0,0 +1,122 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/snapshot.hpp>
+#include <fc/scoped_exit.hpp>
+
+namespace eosio { namespace chain {
+
+   namespace {
+      const uint64_t end_of_sections = std::numeric_limits<uint64_t>::max();
+   }
+
+   snapshot_writer::snapshot_writer( std::ostream& snapshot )
+   :snapshot(snapshot)
+   {
+      const uint32_t magic_number = snapshot_header::magic_number;
+      const uint32_t version = snapshot_header::current_version;
+      snapshot.write( (const char*)&magic_number, sizeof(magic_number) );
+      snapshot.write( (const char*)&version, sizeof(version) );
+   }
+
+   void snapshot_writer::write_start_section( const std::string& section_name ) {
+      EOS_ASSERT( section_pos == std::streampos(-1), snapshot_exception,
+                  "Attempting to write a new section without closing the previous section" );
+      section_pos = snapshot.tellp();
+      row_count = 0;
+
+      // the size and row count are not known yet, they are written by write_end_section
+      uint64_t placeholder = 0;
+      snapshot.write( (const char*)&placeholder, sizeof(placeholder) );
+      snapshot.write( (const char*)&placeholder, sizeof(placeholder) );
+      snapshot.write( section_name.c_str(), section_name.size() + 1 );
+   }
+
+   void snapshot_writer::write_end_section() {
+      auto restore = snapshot.tellp();
+      uint64_t section_size = restore - section_pos - sizeof(uint64_t);
+
+      snapshot.seekp( section_pos );
+      snapshot.write( (const char*)&section_size, sizeof(section_size) );
+      snapshot.write( (const char*)&row_count, sizeof(row_count) );
+      snapshot.seekp( restore );
+
+      section_pos = std::streampos(-1);
+      row_count = 0;
+   }
+
+   void snapshot_writer::finalize() {
+      snapshot.write( (const char*)&end_of_sections, sizeof(end_of_sections) );
+      snapshot.flush();
+   }
+
+   snapshot_reader::snapshot_reader( std::istream& snapshot )
+   :snapshot(snapshot)
+   ,header_pos(snapshot.tellg())
+   {
+   }
+
+   void snapshot_reader::validate() {
+      try {
+         auto old_except = snapshot.exceptions();
+         snapshot.exceptions( std::istream::failbit | std::istream::eofbit );
+         auto restore_except = fc::make_scoped_exit( [&]() { snapshot.exceptions( old_except ); } );
+
+         snapshot.seekg( header_pos );
+         uint32_t magic_number = 0;
+         uint32_t version = 0;
+         snapshot.read( (char*)&magic_number, sizeof(magic_number) );
+         snapshot.read( (char*)&version, sizeof(version) );
+         EOS_ASSERT( magic_number == snapshot_header::magic_number, snapshot_validation_exception,
+                     "Snapshot has invalid magic number" );
+         EOS_ASSERT( version == snapshot_header::current_version, snapshot_validation_exception,
+                     "Unsupported version of snapshot. Snapshot version is ${version} while code supports version ${current}",
+                     ("version", version)("current", snapshot_header::current_version) );
+
+         uint64_t section_size = 0;
+         snapshot.read( (char*)&section_size, sizeof(section_size) );
+         while( section_size != end_of_sections ) {
+            // skip over the section, and make sure the next section header is actually there
+            snapshot.seekg( section_size, std::ios::cur );
+            snapshot.read( (char*)&section_size, sizeof(section_size) );
+         }
+      } catch( const std::exception& e ) {
+         EOS_THROW( snapshot_validation_exception, "Snapshot is truncated or corrupt: ${what}", ("what", e.what()) );
+      }
+   }
+
+   bool snapshot_reader::has_section( const std::string& section_name ) {
+      try {
+         set_section( section_name );
+         return true;
+      } catch( const snapshot_section_not_found& ) {
+         return false;
+      }
+   }
+
+   uint64_t snapshot_reader::set_section( const std::string& section_name ) {
+      snapshot.clear();
+      snapshot.seekg( header_pos + std::streamoff( sizeof(uint32_t) * 2 ) );
+
+      uint64_t section_size = 0;
+      snapshot.read( (char*)&section_size, sizeof(section_size) );
+      while( snapshot && section_size != end_of_sections ) {
+         auto section_start = snapshot.tellg();
+
+         uint64_t row_count = 0;
+         snapshot.read( (char*)&row_count, sizeof(row_count) );
+         std::string name;
+         std::getline( snapshot, name, '\0' );
+         if( name == section_name ) {
+            return row_count;
+         }
+
+         snapshot.seekg( section_start + std::streamoff( section_size ) );
+         snapshot.read( (char*)&section_size, sizeof(section_size) );
+      }
+
+      EOS_THROW( snapshot_section_not_found, "Snapshot has no section named ${name}", ("name", section_name) );
+   }
+
+} } // eosio::chain
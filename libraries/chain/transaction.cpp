@@ -6,6 +6,8 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/multi_index_container.hpp>
@@ -88,16 +90,21 @@ flat_set<public_key_type> transaction::get_signature_keys( const vector<signatur
 
    constexpr size_t recovery_cache_size = 1000;
    static recovery_cache_type recovery_cache;
+   static std::mutex cache_mtx; // keys may be recovered concurrently from worker threads
    const digest_type digest = sig_digest(chain_id, cfd);
+   const transaction_id_type trx_id = use_cache ? id() : transaction_id_type();
 
    flat_set<public_key_type> recovered_pub_keys;
    for(const signature_type& sig : signatures) {
       public_key_type recov;
       if( use_cache ) {
+         std::unique_lock<std::mutex> lock( cache_mtx );
          recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find( sig );
-         if( it == recovery_cache.get<by_sig>().end() || it->trx_id != id()) {
+         if( it == recovery_cache.get<by_sig>().end() || it->trx_id != trx_id) {
+            lock.unlock();
             recov = public_key_type( sig, digest );
-            recovery_cache.emplace_back(cached_pub_key{id(), recov, sig} ); //could fail on dup signatures; not a problem
+            lock.lock();
+            recovery_cache.emplace_back(cached_pub_key{trx_id, recov, sig} ); //could fail on dup signatures; not a problem
          } else {
             recov = it->pub_key;
          }
@@ -113,6 +120,7 @@ flat_set<public_key_type> transaction::get_signature_keys( const vector<signatur
    }
 
    if( use_cache ) {
+      std::lock_guard<std::mutex> lock( cache_mtx );
       while ( recovery_cache.size() > recovery_cache_size )
          recovery_cache.erase( recovery_cache.begin() );
    }
@@ -286,40 +294,67 @@ vector<bytes> packed_transaction::get_context_free_data()const
    } FC_CAPTURE_AND_RETHROW((compression)(packed_context_free_data))
 }
 
+packed_transaction::packed_transaction( const packed_transaction& other )
+:signatures(other.signatures)
+,compression(other.compression)
+,packed_context_free_data(other.packed_context_free_data)
+,packed_trx(other.packed_trx)
+,unpacked_trx(std::atomic_load(&other.unpacked_trx))
+{
+}
+
+packed_transaction& packed_transaction::operator=( const packed_transaction& other )
+{
+   if( this != &other ) {
+      signatures = other.signatures;
+      compression = other.compression;
+      packed_context_free_data = other.packed_context_free_data;
+      packed_trx = other.packed_trx;
+      std::atomic_store( &unpacked_trx, std::atomic_load(&other.unpacked_trx) );
+   }
+   return *this;
+}
+
 time_point_sec packed_transaction::expiration()const
 {
-   local_unpack();
-   return unpacked_trx->expiration;
+   return local_unpack().trx.expiration;
 }
 
 transaction_id_type packed_transaction::id()const
 {
-   local_unpack();
-   return get_transaction().id();
+   return local_unpack().id;
 }
 
-void packed_transaction::local_unpack()const
+const packed_transaction::unpacked& packed_transaction::local_unpack()const
 {
-   if (!unpacked_trx) {
-      try {
-         switch(compression) {
-         case none:
-            unpacked_trx = unpack_transaction(packed_trx);
-            break;
-         case zlib:
-            unpacked_trx = zlib_decompress_transaction(packed_trx);
-            break;
-         default:
-            EOS_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
-         }
-      } FC_CAPTURE_AND_RETHROW((compression)(packed_trx))
-   }
+   auto current = std::atomic_load(&unpacked_trx);
+   if (current) return *current;
+
+   auto result = std::make_shared<unpacked>();
+   try {
+      switch(compression) {
+      case none:
+         result->trx = unpack_transaction(packed_trx);
+         break;
+      case zlib:
+         result->trx = zlib_decompress_transaction(packed_trx);
+         break;
+      default:
+         EOS_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
+      }
+   } FC_CAPTURE_AND_RETHROW((compression)(packed_trx))
+   result->id = result->trx.id();
+
+   // another thread may have decoded it at the same time, everyone keeps the entry published first
+   std::shared_ptr<const unpacked> desired = std::move(result);
+   if (std::atomic_compare_exchange_strong(&unpacked_trx, &current, desired))
+      return *desired;
+   return *current;
 }
 
-transaction packed_transaction::get_transaction()const
+const transaction& packed_transaction::get_transaction()const
 {
-   local_unpack();
-   return transaction(*unpacked_trx);
+   return local_unpack().trx;
 }
 
 signed_transaction packed_transaction::get_signed_transaction() const
@@ -353,6 +388,7 @@ void packed_transaction::set_transaction(const transaction& t, packed_transactio
    } FC_CAPTURE_AND_RETHROW((_compression)(t))
    packed_context_free_data.clear();
    compression = _compression;
+   std::atomic_store( &unpacked_trx, std::shared_ptr<const unpacked>() );
 }
 
 void packed_transaction::set_transaction(const transaction& t, const vector<bytes>& cfd, packed_transaction::compression_type _compression)
@@ -372,6 +408,7 @@ void packed_transaction::set_transaction(const transaction& t, const vector<byte
       }
    } FC_CAPTURE_AND_RETHROW((_compression)(t))
    compression = _compression;
+   std::atomic_store( &unpacked_trx, std::shared_ptr<const unpacked>() );
 }
 
 
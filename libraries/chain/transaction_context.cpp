@@ -21,12 +21,17 @@ namespace eosio { namespace chain {
    ,start(s)
    ,net_usage(trace->net_usage)
    ,pseudo_start(s)
+   ,_deadline_timer(c.get_deadline_timer())
    {
       trace->id = id;
       executed.reserve( trx.total_actions() );
       EOS_ASSERT( trx.transaction_extensions.size() == 0, unsupported_feature, "we don't support any extensions yet" );
    }
 
+   transaction_context::~transaction_context() {
+      _deadline_timer.stop();
+   }
+
    void transaction_context::init(uint64_t initial_net_usage)
    {
       EOS_ASSERT( !is_initialized, transaction_exception, "cannot initialize twice" );
@@ -123,6 +128,7 @@ namespace eosio { namespace chain {
       if( initial_net_usage > 0 )
          add_net_usage( initial_net_usage );  // Fail early if current net usage is already greater than the calculated limit
 
+      _deadline_timer.start( _deadline );
       checktime(); // Fail early if deadline has already been exceeded
 
       is_initialized = true;
@@ -180,6 +186,9 @@ namespace eosio { namespace chain {
    void transaction_context::exec() {
       EOS_ASSERT( is_initialized, transaction_exception, "must first initialize" );
 
+      trace->action_traces.reserve( (apply_context_free ? trx.context_free_actions.size() : 0) + trx.actions.size() );
+      executed.reserve( trace->action_traces.capacity() );
+
       if( apply_context_free ) {
          for( const auto& act : trx.context_free_actions ) {
             trace->action_traces.emplace_back();
@@ -281,27 +290,33 @@ namespace eosio { namespace chain {
    }
 
    void transaction_context::checktime()const {
+      if( BOOST_LIKELY( !_deadline_timer.expired ) )
+         return;
+
       auto now = fc::time_point::now();
-      if( BOOST_UNLIKELY( now > _deadline ) ) {
-         // edump((now-start)(now-pseudo_start));
-         if( explicit_billed_cpu_time || deadline_exception_code == deadline_exception::code_value ) {
-            EOS_THROW( deadline_exception, "deadline exceeded", ("now", now)("deadline", _deadline)("start", start) );
-         } else if( deadline_exception_code == block_cpu_usage_exceeded::code_value ) {
-            EOS_THROW( block_cpu_usage_exceeded,
-                       "not enough time left in block to complete executing transaction",
-                       ("now", now)("deadline", _deadline)("start", start)("billing_timer", now - pseudo_start) );
-         } else if( deadline_exception_code == tx_cpu_usage_exceeded::code_value ) {
-            EOS_THROW( tx_cpu_usage_exceeded,
-                       "transaction was executing for too long",
-                       ("now", now)("deadline", _deadline)("start", start)("billing_timer", now - pseudo_start) );
-         } else if( deadline_exception_code == leeway_deadline_exception::code_value ) {
-            EOS_THROW( leeway_deadline_exception,
-                       "the transaction was unable to complete by deadline, "
-                       "but it is possible it could have succeeded if it were allowed to run to completion",
-                       ("now", now)("deadline", _deadline)("start", start)("billing_timer", now - pseudo_start) );
-         }
-         EOS_ASSERT( false,  transaction_exception, "unexpected deadline exception code" );
+      if( BOOST_UNLIKELY( now <= _deadline ) ) {
+         // the timer fired for a deadline that has since been moved out
+         _deadline_timer.start( _deadline );
+         return;
       }
+      // edump((now-start)(now-pseudo_start));
+      if( explicit_billed_cpu_time || deadline_exception_code == deadline_exception::code_value ) {
+         EOS_THROW( deadline_exception, "deadline exceeded", ("now", now)("deadline", _deadline)("start", start) );
+      } else if( deadline_exception_code == block_cpu_usage_exceeded::code_value ) {
+         EOS_THROW( block_cpu_usage_exceeded,
+                    "not enough time left in block to complete executing transaction",
+                    ("now", now)("deadline", _deadline)("start", start)("billing_timer", now - pseudo_start) );
+      } else if( deadline_exception_code == tx_cpu_usage_exceeded::code_value ) {
+         EOS_THROW( tx_cpu_usage_exceeded,
+                    "transaction was executing for too long",
+                    ("now", now)("deadline", _deadline)("start", start)("billing_timer", now - pseudo_start) );
+      } else if( deadline_exception_code == leeway_deadline_exception::code_value ) {
+         EOS_THROW( leeway_deadline_exception,
+                    "the transaction was unable to complete by deadline, "
+                    "but it is possible it could have succeeded if it were allowed to run to completion",
+                    ("now", now)("deadline", _deadline)("start", start)("billing_timer", now - pseudo_start) );
+      }
+      EOS_ASSERT( false,  transaction_exception, "unexpected deadline exception code" );
    }
 
    void transaction_context::pause_billing_timer() {
@@ -325,6 +340,7 @@ namespace eosio { namespace chain {
          _deadline = deadline;
          deadline_exception_code = deadline_exception::code_value;
       }
+      _deadline_timer.start( _deadline );
    }
 
    void transaction_context::validate_cpu_usage_to_bill( int64_t billed_us, bool check_minimum )const {
@@ -396,6 +412,21 @@ namespace eosio { namespace chain {
       return std::make_tuple(account_net_limit, account_cpu_limit, greylisted);
    }
 
+   apply_context_buffers transaction_context::take_apply_buffers() {
+      if( _spare_apply_buffers.empty() )
+         return apply_context_buffers();
+      auto buffers = std::move( _spare_apply_buffers.back() );
+      _spare_apply_buffers.pop_back();
+      return buffers;
+   }
+
+   void transaction_context::return_apply_buffers( apply_context_buffers&& buffers ) {
+      buffers.notified.clear();
+      buffers.inline_actions.clear();
+      buffers.cfa_inline_actions.clear();
+      _spare_apply_buffers.emplace_back( std::move(buffers) );
+   }
+
    void transaction_context::dispatch_action( action_trace& trace, const action& a, account_name receiver, bool context_free, uint32_t recurse_depth ) {
       apply_context  acontext( control, *this, a, recurse_depth );
       acontext.context_free = context_free;
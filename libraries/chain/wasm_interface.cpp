@@ -27,7 +27,8 @@ namespace eosio { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm) : my( new wasm_interface_impl(vm) ) {}
+   wasm_interface::wasm_interface(vm_type vm, const fc::path& code_cache_dir, const cache_limits& limits)
+   : my( new wasm_interface_impl(vm, code_cache_dir, limits) ) {}
 
    wasm_interface::~wasm_interface() {}
 
@@ -50,11 +51,19 @@ namespace eosio { namespace chain {
 
       //there are a couple opportunties for improvement here--
       //Easy: Cache the Module created here so it can be reused for instantiaion
-      //Hard: Kick off instantiation in a separate thread at this location
+      //Instantiation is kicked off in a separate thread by apply_eosio_setcode once the code is accepted
 	 }
 
+   void wasm_interface::compile_async( const digest_type& code_id, const bytes& code ) {
+      my->compile_async(code_id, code);
+   }
+
    void wasm_interface::apply( const digest_type& code_id, const shared_string& code, apply_context& context ) {
-      my->get_instantiated_module(code_id, code, context.trx_context)->apply(context);
+      my->get_instantiated_module(code_id, code, context)->apply(context);
+   }
+
+   wasm_interface::cache_stats wasm_interface::get_cache_stats()const {
+      return my->get_cache_stats();
    }
 
    wasm_instantiated_module_interface::~wasm_instantiated_module_interface() {}
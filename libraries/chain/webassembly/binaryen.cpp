@@ -39,10 +39,9 @@ class binaryen_instantiated_module : public wasm_instantiated_module_interface {
          const unsigned initial_memory_size = _module->memory.initial*Memory::kPageSize;
          interpreter_interface local_interface(_shared_linear_memory, _table, _import_lut, initial_memory_size, context);
 
-         //zero out the initial pages
-         memset(_shared_linear_memory.data, 0, initial_memory_size);
-         //copy back in the initial data
+         //copy back in the initial data and zero out the rest of the initial pages, each byte is written once
          memcpy(_shared_linear_memory.data, _initial_memory.data(), _initial_memory.size());
+         memset(_shared_linear_memory.data + _initial_memory.size(), 0, initial_memory_size - _initial_memory.size());
          
          //be aware that construction of the ModuleInstance implictly fires the start function
          ModuleInstance instance(*_module.get(), &local_interface);
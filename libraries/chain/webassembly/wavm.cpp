@@ -12,7 +12,10 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Intrinsics.h"
 
+#include <atomic>
 #include <mutex>
+#include <set>
+#include <vector>
 
 using namespace IR;
 using namespace Runtime;
@@ -21,13 +24,72 @@ namespace eosio { namespace chain { namespace webassembly { namespace wavm {
 
 running_instance_context the_running_instance_context;
 
+/**
+ * WAVM keeps every object it creates in one process wide list and only deletes them in
+ * freeUnreferencedObjects, which frees whatever is not reachable from the roots it is given. The roots
+ * are the instances of every live wavm_instantiated_module of every runtime in the process, and the lock
+ * also covers instantiation, which adds to WAVM's list and may run on a compile thread.
+ *
+ * Instantiation holds the lock for a whole compile, so a released module does not wait for it: its
+ * instance is queued, and freed by whoever next holds the lock without waiting for it, at the latest
+ * when the running instantiation finishes.
+ */
+static std::set<ModuleInstance*>    __live_instances;
+static std::mutex                   __live_instances_lock;
+static std::vector<ModuleInstance*> __released_instances;
+static std::mutex                   __released_instances_lock;
+
+// only call with __live_instances_lock held
+static void free_released_instances() {
+   std::vector<ModuleInstance*> released;
+   {
+      std::lock_guard<std::mutex> l(__released_instances_lock);
+      released.swap(__released_instances);
+   }
+   if(released.empty())
+      return;
+   for(auto* instance : released)
+      __live_instances.erase(instance);
+   // also releases whatever a failed instantiation left behind
+   Runtime::freeUnreferencedObjects(std::vector<ObjectInstance*>(__live_instances.begin(), __live_instances.end()));
+}
+
+// initial memory images smaller than this are copied in on every call, mapping them costs more than the copy
+static constexpr size_t copy_on_write_memory_threshold = 64*1024;
+// each page image holds a file descriptor, beyond this many live images modules copy their memory instead
+static constexpr uint32_t max_page_images = 256;
+static std::atomic<uint32_t> __live_page_images{0};
+
 class wavm_instantiated_module : public wasm_instantiated_module_interface {
    public:
       wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem) :
          _initial_memory(initial_mem),
          _instance(instance),
          _module(std::move(module))
-      {}
+      {
+         if(_initial_memory.size() >= copy_on_write_memory_threshold) {
+            if(++__live_page_images <= max_page_images)
+               _memory_image = Platform::createPageImage(_initial_memory.data(), _initial_memory.size());
+            if(!_memory_image)
+               --__live_page_images;
+         }
+      }
+
+      ~wavm_instantiated_module() {
+         if(_memory_image) {
+            Platform::destroyPageImage(_memory_image);
+            --__live_page_images;
+         }
+
+         // releases the instance with its jitted code, unless a compile holds the lock; it frees it when done
+         {
+            std::lock_guard<std::mutex> l(__released_instances_lock);
+            __released_instances.push_back(_instance);
+         }
+         std::unique_lock<std::mutex> l(__live_instances_lock, std::try_to_lock);
+         if(l.owns_lock())
+            free_released_instances();
+      }
 
       void apply(apply_context& context) override {
          vector<Value> args = {Value(uint64_t(context.receiver)),
@@ -49,7 +111,10 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             //The memory instance is reused across all wavm_instantiated_modules, but for wasm instances
             // that didn't declare "memory", getDefaultMemory() won't see it
             MemoryInstance* default_mem = getDefaultMemory(_instance);
-            if(default_mem) {
+            if(default_mem && _memory_image) {
+               //maps the initial memory copy-on-write, so the call only pays for the pages it touches
+               resetMemory(default_mem, _module->memories.defs[0].type, _memory_image);
+            } else if(default_mem) {
                //reset memory resizes the sandbox'ed memory to the module's init memory size and then
                // (effectively) memzeros it all
                resetMemory(default_mem, _module->memories.defs[0].type);
@@ -75,8 +140,10 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
 
 
       std::vector<uint8_t>     _initial_memory;
+      //null when the image is small, max_page_images are live or the platform cannot map it; the memory is then reset by copying
+      Platform::PageImage*     _memory_image = nullptr;
       //naked pointer because ModuleInstance is opaque
-      //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
+      //_instance is deleted via WAVM's object garbage collection when this module is destroyed
       ModuleInstance*          _instance;
       std::unique_ptr<Module>  _module;
 };
@@ -119,10 +186,13 @@ std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_mo
       EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
    }
 
+   std::lock_guard<std::mutex> l(__live_instances_lock);
    eosio::chain::webassembly::common::root_resolver resolver;
    LinkResult link_result = linkModule(*module, resolver);
    ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports));
    EOS_ASSERT(instance != nullptr, wasm_exception, "Fail to Instantiate WAVM Module");
+   __live_instances.insert(instance);
+   free_released_instances();
 
    return std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory);
 }
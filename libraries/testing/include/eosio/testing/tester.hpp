@@ -82,10 +82,10 @@ namespace eosio { namespace testing {
          virtual ~base_tester() {};
 
          void              init(bool push_genesis = true, db_read_mode read_mode = db_read_mode::SPECULATIVE);
-         void              init(controller::config config);
+         void              init(controller::config config, const snapshot_reader_ptr& snapshot = nullptr);
 
          void              close();
-         void              open();
+         void              open( const snapshot_reader_ptr& snapshot = nullptr );
          bool              is_same_chain( base_tester& other );
 
          virtual signed_block_ptr produce_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms), uint32_t skip_flag = 0/*skip_missed_block_penalty*/ ) = 0;
@@ -272,6 +272,8 @@ namespace eosio { namespace testing {
          // tempdir field must come before control so that during destruction the tempdir is deleted only after controller finishes
          fc::temp_directory                            tempdir;
       public:
+         const controller::config& get_config()const { return cfg; }
+
          unique_ptr<controller> control;
          std::map<chain::public_key_type, chain::private_key_type> block_signing_private_keys;
       protected:
@@ -286,8 +288,8 @@ namespace eosio { namespace testing {
          init(push_genesis, read_mode);
       }
 
-      tester(controller::config config) {
-         init(config);
+      tester(controller::config config, const snapshot_reader_ptr& snapshot = nullptr) {
+         init(config, snapshot);
       }
 
       signed_block_ptr produce_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms), uint32_t skip_flag = 0/*skip_missed_block_penalty*/ )override {
@@ -111,9 +111,9 @@ namespace eosio { namespace testing {
    }
 
 
-   void base_tester::init(controller::config config) {
+   void base_tester::init(controller::config config, const snapshot_reader_ptr& snapshot) {
       cfg = config;
-      open();
+      open(snapshot);
    }
 
 
@@ -123,16 +123,16 @@ namespace eosio { namespace testing {
    }
 
 
-   void base_tester::open() {
+   void base_tester::open( const snapshot_reader_ptr& snapshot ) {
       control.reset( new controller(cfg) );
-      control->startup();
+      control->startup(snapshot);
       chain_transactions.clear();
       control->accepted_block.connect([this]( const block_state_ptr& block_state ){
         FC_ASSERT( block_state->block );
           for( const auto& receipt : block_state->block->transactions ) {
               if( receipt.trx.contains<packed_transaction>() ) {
                   auto &pt = receipt.trx.get<packed_transaction>();
-                  chain_transactions[pt.get_transaction().id()] = receipt;
+                  chain_transactions[pt.id()] = receipt;
               } else {
                   auto& id = receipt.trx.get<transaction_id_type>();
                   chain_transactions[id] = receipt;
@@ -0,0 +1,59 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace eosio { namespace utilities {
+
+/**
+ * @brief Latency histogram that can be updated from any thread
+ *
+ * Observations are counted into fixed buckets with relaxed atomic increments, so recording costs a handful of
+ * comparisons and two uncontended atomic adds. The bucket bounds match the Prometheus convention: bucket i counts
+ * the observations less than or equal to bounds[i], the last bucket is +Inf.
+ */
+class latency_histogram {
+   public:
+      static constexpr size_t bound_count = 14;
+      static const std::array<uint64_t, bound_count>& bounds_us() {
+         static const std::array<uint64_t, bound_count> bounds{{
+            100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000
+         }};
+         return bounds;
+      }
+
+      struct snapshot {
+         std::array<uint64_t, bound_count + 1> buckets{}; ///< not cumulative, the last one is +Inf
+         uint64_t                              count  = 0;
+         uint64_t                              sum_us = 0;
+      };
+
+      void observe( uint64_t us ) {
+         const auto& bounds = bounds_us();
+         size_t i = 0;
+         while( i < bound_count && us > bounds[i] ) ++i;
+         _buckets[i].fetch_add( 1, std::memory_order_relaxed );
+         _sum_us.fetch_add( us, std::memory_order_relaxed );
+      }
+
+      snapshot get()const {
+         snapshot s;
+         for( size_t i = 0; i < _buckets.size(); ++i ) {
+            s.buckets[i] = _buckets[i].load( std::memory_order_relaxed );
+            s.count += s.buckets[i];
+         }
+         s.sum_us = _sum_us.load( std::memory_order_relaxed );
+         return s;
+      }
+
+   private:
+      std::array<std::atomic<uint64_t>, bound_count + 1> _buckets{};
+      std::atomic<uint64_t>                              _sum_us{0};
+};
+
+} } // eosio::utilities
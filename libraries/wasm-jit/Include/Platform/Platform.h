@@ -94,6 +94,27 @@ namespace Platform
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// Replaces the specified virtual pages with fresh zeroed pages that allow the given access, dropping whatever was mapped there.
+	// Physical memory is only committed to the pages when they are touched.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	// Return true if successful.
+	PLATFORM_API bool resetVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access);
+
+	// A page aligned copy of some data that can be mapped copy-on-write into virtual pages.
+	struct PageImage;
+
+	// Creates a page image of numBytes of data, padded with zeros to a whole number of pages.
+	// Returns nullptr if the platform does not support page images.
+	PLATFORM_API PageImage* createPageImage(const U8* data,Uptr numBytes);
+	PLATFORM_API void destroyPageImage(PageImage* image);
+	PLATFORM_API Uptr getPageImageNumPages(PageImage* image);
+
+	// Maps the whole image copy-on-write at baseVirtualAddress, replacing whatever was mapped there.
+	// A page is only copied when it is first written to.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	// Return true if successful.
+	PLATFORM_API bool mapPageImage(U8* baseVirtualAddress,PageImage* image);
+
 	//
 	// Call stack and exceptions
 	//
@@ -10,6 +10,7 @@
 
 // Declare IR::Module to avoid including the definition.
 namespace IR { struct Module; }
+namespace Platform { struct PageImage; }
 
 namespace Runtime
 {
@@ -213,6 +214,9 @@ namespace Runtime
 	RUNTIME_API void runInstanceStartFunc(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
+	// Resets the memory to newMemoryType's minimum size with image mapped copy-on-write at its start and zeros after it.
+	// Only the pages touched afterwards are copied or zero filled. The image must fit in the minimum size.
+	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType, Platform::PageImage* image);
 
 	// Gets an object exported by a ModuleInstance by name.
 	RUNTIME_API ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name);
@@ -7,12 +7,14 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include <errno.h>
 #include <signal.h>
 #include <setjmp.h>
 #include <sys/resource.h>
 #include <string.h>
+#include <stdlib.h>
 #include <iostream>
 #include <string>
 
@@ -96,9 +98,9 @@ namespace Platform
 	void decommitVirtualPages(U8* baseVirtualAddress,Uptr numPages)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
-		auto numBytes = numPages << getPageSizeLog2();
-		if(madvise(baseVirtualAddress,numBytes,MADV_DONTNEED)) { Errors::fatal("madvise failed"); }
-		if(mprotect(baseVirtualAddress,numBytes,PROT_NONE)) { Errors::fatal("mprotect failed"); }
+		// A fresh anonymous mapping rather than madvise(MADV_DONTNEED): on a private file mapping (a page image)
+		// that would bring back the file's contents instead of zeros.
+		if(!resetVirtualPages(baseVirtualAddress,numPages,MemoryAccess::None)) { Errors::fatal("mmap failed"); }
 	}
 
 	void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
@@ -107,6 +109,59 @@ namespace Platform
 		if(munmap(baseVirtualAddress,numPages << getPageSizeLog2())) { Errors::fatal("munmap failed"); }
 	}
 
+	bool resetVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		auto result = mmap(baseVirtualAddress,numPages << getPageSizeLog2(),memoryAccessAsPOSIXFlag(access),MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,-1,0);
+		return result != MAP_FAILED;
+	}
+
+	struct PageImage
+	{
+		int fd;
+		Uptr numPages;
+	};
+
+	PageImage* createPageImage(const U8* data,Uptr numBytes)
+	{
+		const Uptr numPages = (numBytes + (Uptr(1) << getPageSizeLog2()) - 1) >> getPageSizeLog2();
+		#if defined(__linux__) && defined(SYS_memfd_create)
+			int fd = (int)syscall(SYS_memfd_create,"wasm-page-image",0);
+		#else
+			char path[] = "/tmp/wasm-page-image-XXXXXX";
+			int fd = mkstemp(path);
+			if(fd != -1) { unlink(path); }
+		#endif
+		if(fd == -1) { return nullptr; }
+
+		bool written = ftruncate(fd,numPages << getPageSizeLog2()) == 0;
+		for(Uptr offset = 0;written && offset < numBytes;)
+		{
+			auto result = pwrite(fd,data + offset,numBytes - offset,offset);
+			if(result < 0 && errno == EINTR) { continue; }
+			written = result > 0;
+			if(written) { offset += result; }
+		}
+		if(!written) { close(fd); return nullptr; }
+		return new PageImage{fd,numPages};
+	}
+
+	void destroyPageImage(PageImage* image)
+	{
+		if(!image) { return; }
+		close(image->fd);
+		delete image;
+	}
+
+	Uptr getPageImageNumPages(PageImage* image) { return image->numPages; }
+
+	bool mapPageImage(U8* baseVirtualAddress,PageImage* image)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		auto result = mmap(baseVirtualAddress,image->numPages << getPageSizeLog2(),PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_FIXED,image->fd,0);
+		return result != MAP_FAILED;
+	}
+
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription)
 	{
 		#if defined __linux__ || defined __FreeBSD__
@@ -78,6 +78,19 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
 	}
 
+	bool resetVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access)
+	{
+		decommitVirtualPages(baseVirtualAddress,numPages);
+		return access == MemoryAccess::None || commitVirtualPages(baseVirtualAddress,numPages,access);
+	}
+
+	// Page images are not supported on Windows; callers fall back to copying the data.
+	struct PageImage {};
+	PageImage* createPageImage(const U8* data,Uptr numBytes) { return nullptr; }
+	void destroyPageImage(PageImage* image) {}
+	Uptr getPageImageNumPages(PageImage* image) { return 0; }
+	bool mapPageImage(U8* baseVirtualAddress,PageImage* image) { return false; }
+
 	void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
@@ -89,6 +89,13 @@ namespace Runtime
 	}
 
 	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
+		// Put anonymous pages back under the image a previous call mapped, so that nothing here is backed by its file.
+		if(memory->hasPageImage)
+		{
+			if(!Platform::resetVirtualPages(memory->baseAddress,memory->numPages << getPlatformPagesPerWebAssemblyPageLog2(),Platform::MemoryAccess::ReadWrite))
+				causeException(Exception::Cause::outOfMemory);
+			memory->hasPageImage = false;
+		}
 		memory->type.size.min = 1;
 		if(shrinkMemory(memory, memory->numPages - 1) == -1)
 			causeException(Exception::Cause::outOfMemory);
@@ -98,6 +105,31 @@ namespace Runtime
 			causeException(Exception::Cause::outOfMemory);
    }
 
+	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType, Platform::PageImage* image)
+	{
+		WAVM_ASSERT_THROW(newMemoryType.size.min <= UINTPTR_MAX);
+		const Uptr pageSizeLog2 = Platform::getPageSizeLog2();
+		const Uptr oldNumPlatformPages = memory->numPages << getPlatformPagesPerWebAssemblyPageLog2();
+		const Uptr newNumPlatformPages = Uptr(newMemoryType.size.min) << getPlatformPagesPerWebAssemblyPageLog2();
+		const Uptr imageNumPlatformPages = Platform::getPageImageNumPages(image);
+		errorUnless(imageNumPlatformPages <= newNumPlatformPages);
+
+		// Fresh mappings rather than memset: pages the last call touched are dropped, and the ones the next call
+		// touches are zero filled (or copied from the image) by the kernel on first access.
+		if(newNumPlatformPages > imageNumPlatformPages
+		&& !Platform::resetVirtualPages(memory->baseAddress + (imageNumPlatformPages << pageSizeLog2),newNumPlatformPages - imageNumPlatformPages,Platform::MemoryAccess::ReadWrite))
+			causeException(Exception::Cause::outOfMemory);
+		if(oldNumPlatformPages > newNumPlatformPages
+		&& !Platform::resetVirtualPages(memory->baseAddress + (newNumPlatformPages << pageSizeLog2),oldNumPlatformPages - newNumPlatformPages,Platform::MemoryAccess::None))
+			causeException(Exception::Cause::outOfMemory);
+		if(!Platform::mapPageImage(memory->baseAddress,image))
+			causeException(Exception::Cause::outOfMemory);
+
+		memory->hasPageImage = true;
+		memory->type = newMemoryType;
+		memory->numPages = Uptr(newMemoryType.size.min);
+	}
+
 	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
 	{
 		const Uptr previousNumPages = memory->numPages;
@@ -88,7 +88,10 @@ namespace Runtime
 		U8* reservedBaseAddress;
 		Uptr reservedNumPlatformPages;
 
-		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0) {}
+		// Whether a page image is mapped at the start of the memory by the last reset.
+		bool hasPageImage;
+
+		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0), hasPageImage(false) {}
 		~MemoryInstance() override;
 
       static MemoryInstance* theMemoryInstance;
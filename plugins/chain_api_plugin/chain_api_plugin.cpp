@@ -47,6 +47,19 @@ struct async_result_visitor : public fc::visitor<std::string> {
           } \
        }}
 
+// for calls that render their own JSON text instead of returning a result to be converted by fc::json
+#define CALL_JSON(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [this, api_handle](string, string body, url_response_callback cb) mutable { \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto result = api_handle.call_name ## _json(fc::json::from_string(body).as<api_namespace::call_name ## _params>()); \
+             cb(http_response_code, std::move(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
 #define CALL_ASYNC(api_name, api_handle, api_namespace, call_name, call_result, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [this, api_handle](string, string body, url_response_callback cb) mutable { \
@@ -67,6 +80,7 @@ struct async_result_visitor : public fc::visitor<std::string> {
 }
 
 #define CHAIN_RO_CALL(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL_JSON(call_name, http_response_code) CALL_JSON(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 #define CHAIN_RW_CALL(call_name, http_response_code) CALL(chain, rw_api, chain_apis::read_write, call_name, http_response_code)
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
@@ -79,13 +93,14 @@ void chain_api_plugin::plugin_startup() {
 
    app().get_plugin<http_plugin>().add_api({
       CHAIN_RO_CALL(get_info, 200l),
+      CHAIN_RO_CALL(get_block_timing, 200),
       CHAIN_RO_CALL(get_block, 200),
       CHAIN_RO_CALL(get_block_header_state, 200),
       CHAIN_RO_CALL(get_account, 200),
       CHAIN_RO_CALL(get_code, 200),
       CHAIN_RO_CALL(get_abi, 200),
       CHAIN_RO_CALL(get_raw_code_and_abi, 200),
-      CHAIN_RO_CALL(get_table_rows, 200),
+      CHAIN_RO_CALL_JSON(get_table_rows, 200),
       CHAIN_RO_CALL(get_currency_balance, 200),
       CHAIN_RO_CALL(get_currency_stats, 200),
       CHAIN_RO_CALL(get_producers, 200),
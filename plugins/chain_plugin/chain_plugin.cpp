@@ -29,6 +29,7 @@
 #include <fc/io/json.hpp>
 #include <fc/variant.hpp>
 #include <signal.h>
+#include <fstream>
 
 namespace eosio {
 
@@ -127,6 +128,7 @@ public:
    fc::optional<controller::config> chain_config;
    fc::optional<controller>         chain;
    fc::optional<chain_id_type>      chain_id;
+   fc::optional<bfs::path>          snapshot_path;
    //txn_msg_rate_limits              rate_limits;
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_ms;
@@ -179,14 +181,22 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "the location of the blocks directory (absolute path or relative to application data dir)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("wasm-runtime", bpo::value<eosio::chain::wasm_interface::vm_type>()->value_name("wavm/binaryen"), "Override default WASM runtime")
+         ("wasm-cache-max-entries", bpo::value<uint32_t>()->default_value(config::default_wasm_cache_max_entries),
+          "Maximum number of instantiated contracts kept in memory, 0 for no limit. Contracts of privileged accounts are always kept")
+         ("wasm-cache-max-code-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_cache_max_code_size / (1024  * 1024)),
+          "Maximum total size (in MiB) of the instantiated contracts kept in memory, 0 for no limit")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
+         ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
+          "Number of worker threads in controller thread pool")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
          ("chain-state-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the chain state database drops below this size (in MiB).")
          ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024  * 1024)), "Maximum size (in MiB) of the reversible blocks database")
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
+         ("log-block-timing", bpo::bool_switch()->default_value(false),
+          "log the time spent in each stage of every block applied or produced, see also /v1/chain/get_block_timing")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
           "Account added to actor whitelist (may specify multiple times)")
          ("actor-blacklist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -219,6 +229,7 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cli.add_options()
          ("genesis-json", bpo::value<bfs::path>(), "File to read Genesis State from")
          ("genesis-timestamp", bpo::value<string>(), "override the initial timestamp in the Genesis State file")
+         ("snapshot", bpo::value<bfs::path>(), "File to read Snapshot State from")
          ("print-genesis-json", bpo::bool_switch()->default_value(false),
           "extract genesis_state from blocks.log as JSON, print to console, and exit")
          ("extract-genesis-json", bpo::value<bfs::path>(),
@@ -377,10 +388,18 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
+      my->chain_config->thread_pool_size = options.at( "chain-threads" ).as<uint16_t>();
+      EOS_ASSERT( my->chain_config->thread_pool_size > 0, plugin_config_exception,
+                  "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
+
+      my->chain_config->wasm_cache_limits.max_entries = options.at( "wasm-cache-max-entries" ).as<uint32_t>();
+      my->chain_config->wasm_cache_limits.max_code_size = options.at( "wasm-cache-max-code-size-mb" ).as<uint64_t>() * 1024 * 1024;
+
       /** ²ҪطŲʱκμ飬עһ */
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
       /** Ƿڿ̨ԼϢ */
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
+      my->chain_config->log_block_timing = options.at( "log-block-timing" ).as<bool>();
       /** ҪļߴӡļӿĴ洢·µblocks.logȡgenesis_stateJSONʽ¼дָļȻ˳ */
       if( options.count( "extract-genesis-json" ) || options.at( "print-genesis-json" ).as<bool>()) {
          genesis_state gs;
@@ -502,7 +521,31 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       }
 
       /** ⲿָgenesisļҪ³еgenesis״̬ */
-      if( options.count( "genesis-json" )) {
+      if( options.count( "snapshot" )) {
+         my->snapshot_path = options.at( "snapshot" ).as<bfs::path>();
+         EOS_ASSERT( fc::is_regular_file( *my->snapshot_path ), plugin_config_exception,
+                     "Cannot load snapshot, ${name} does not exist", ("name", my->snapshot_path->generic_string()) );
+         EOS_ASSERT( !options.count( "genesis-json" ) && !options.count( "genesis-timestamp" ), plugin_config_exception,
+                     "--snapshot is incompatible with --genesis-json and --genesis-timestamp as the snapshot contains genesis information" );
+         EOS_ASSERT( !fc::exists( my->chain_config->state_dir / "shared_memory.bin" ), plugin_config_exception,
+                     "Snapshot can only be used to initialize an empty database." );
+
+         // the genesis state in the snapshot determines the chain id
+         std::ifstream snapshot_stream( my->snapshot_path->generic_string(), std::ios::in | std::ios::binary );
+         snapshot_reader reader( snapshot_stream );
+         reader.validate();
+         reader.read_section<genesis_state>( [this]( auto& section ) {
+            section.read_row( my->chain_config->genesis );
+         });
+
+         if( fc::is_regular_file( my->blocks_dir / "blocks.log" )) {
+            auto log_chain_id = block_log::extract_genesis_state( my->blocks_dir ).compute_chain_id();
+            EOS_ASSERT( log_chain_id == my->chain_config->genesis.compute_chain_id(), plugin_config_exception,
+                        "Genesis information in blocks.log does not match the snapshot" );
+         }
+
+         ilog( "Starting up from snapshot '${snapshot}'", ("snapshot", my->snapshot_path->generic_string()) );
+      } else if( options.count( "genesis-json" )) {
          EOS_ASSERT( !fc::exists( my->blocks_dir / "blocks.log" ),
                      plugin_config_exception,
                     "Genesis state can only be set on a fresh blockchain." );
@@ -633,7 +676,12 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 void chain_plugin::plugin_startup()
 { try {
    try {
-      my->chain->startup();
+      if( my->snapshot_path ) {
+         std::ifstream snapshot_stream( my->snapshot_path->generic_string(), std::ios::in | std::ios::binary );
+         my->chain->startup( std::make_shared<snapshot_reader>( snapshot_stream ) );
+      } else {
+         my->chain->startup();
+      }
    } catch (const database_guard_exception& e) {
       log_guard_exception(e);
       // make sure to properly close the db
@@ -945,6 +993,10 @@ read_only::get_info_results read_only::get_info(const read_only::get_info_params
    };
 }
 
+read_only::get_block_timing_results read_only::get_block_timing(const read_only::get_block_timing_params&) const {
+   return { db.get_block_timings() };
+}
+
 uint64_t read_only::get_table_index_name(const read_only::get_table_rows_params& p, bool& primary) {
    using boost::algorithm::starts_with;
    // see multi_index packing of index name
@@ -1019,79 +1071,105 @@ uint64_t convert_to_type(const string& str, const string& desc) {
    return value;
 }
 
-abi_def get_abi( const controller& db, const name& account ) {
-   const auto &d = db.db();
-   const account_object *code_accnt = d.find<account_object, by_name>(account);
-   EOS_ASSERT(code_accnt != nullptr, chain::account_query_exception, "Fail to retrieve account for ${account}", ("account", account) );
-   abi_def abi;
-   abi_serializer::to_abi(code_accnt->abi, abi);
-   return abi;
+/// index type of a table, answered from the shared serializer instead of unpacking the ABI again
+string get_table_type( const abi_serializer& abis, const name& table_name ) {
+   EOS_ASSERT( !abis.get_table_type( table_name ).empty(), chain::contract_table_query_exception,
+               "Table ${table} is not specified in the ABI", ("table",table_name) );
+   return abis.get_table_index_type( table_name );
 }
 
-string get_table_type( const abi_def& abi, const name& table_name ) {
-   for( const auto& t : abi.tables ) {
-      if( t.name == table_name ){
-         return t.index_type;
-      }
-   }
-   EOS_ASSERT( false, chain::contract_table_query_exception, "Table ${table} is not specified in the ABI", ("table",table_name) );
+/// the shared serializer of the account's ABI, which must exist
+static abi_serializer_ptr get_abi_serializer( const controller& db, const name& account, const fc::microseconds& abi_serializer_max_time ) {
+   auto abis = db.get_abi_serializer( account, abi_serializer_max_time );
+   EOS_ASSERT( abis, abi_not_found_exception, "No ABI found for ${contract}", ("contract", account) );
+   return abis;
 }
 
-read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-
+template<typename RowFn>
+bool read_only::walk_table_rows( const read_only::get_table_rows_params& p, RowFn&& on_row )const {
    bool primary = false;
    auto table_with_index = get_table_index_name( p, primary );
    if( primary ) {
       EOS_ASSERT( p.table == table_with_index, chain::contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
-      auto table_type = get_table_type( abi, p.table );
+      auto table_type = get_table_type( *get_abi_serializer( db, p.code, abi_serializer_max_time ), p.table );
       if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
-         return get_table_rows_ex<key_value_index>(p,abi);
+         return walk_table_rows_ex<key_value_index>(p, on_row);
       }
-      EOS_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
+      EOS_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type));
    } else {
       EOS_ASSERT( !p.key_type.empty(), chain::contract_table_query_exception, "key type required for non-primary index" );
-
       if (p.key_type == "i64" || p.key_type == "name") {
-         return get_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
+         return walk_table_rows_by_seckey<index64_index, uint64_t>(p, [](uint64_t v)->uint64_t {
             return v;
-         });
+         }, on_row);
       }
       else if (p.key_type == "i128") {
-         return get_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
+         return walk_table_rows_by_seckey<index128_index, uint128_t>(p, [](uint128_t v)->uint128_t {
             return v;
-         });
+         }, on_row);
       }
       else if (p.key_type == "i256") {
-         return get_table_rows_by_seckey<index256_index, uint256_t>(p, abi, [](uint256_t v)->key256_t {
+         return walk_table_rows_by_seckey<index256_index, uint256_t>(p, [](uint256_t v)->key256_t {
             key256_t k;
             k[0] = ((uint128_t *)&v)[0];
             k[1] = ((uint128_t *)&v)[1];
             return k;
-         });
+         }, on_row);
       }
       else if (p.key_type == "float64") {
-         return get_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
+         return walk_table_rows_by_seckey<index_double_index, double>(p, [](double v)->float64_t {
             float64_t f = *(float64_t *)&v;
             return f;
-         });
+         }, on_row);
       }
       else if (p.key_type == "float128") {
-         return get_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
+         return walk_table_rows_by_seckey<index_long_double_index, double>(p, [](double v)->float128_t{
             float64_t f = *(float64_t *)&v;
             float128_t f128;
             f64_to_f128M(f, &f128);
             return f128;
-         });
+         }, on_row);
       }
       EOS_ASSERT(false, chain::contract_table_query_exception,  "Unsupported secondary index type: ${t}", ("t", p.key_type));
    }
 }
 
+read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
+   read_only::get_table_rows_result result;
+   const auto abis = get_abi_serializer( db, p.code, abi_serializer_max_time );
+
+   result.more = walk_table_rows( p, [&]( const vector<char>& data ) {
+      if( p.json ) {
+         result.rows.emplace_back( abis->binary_to_variant( abis->get_table_type(p.table), data, abi_serializer_max_time ) );
+      } else {
+         result.rows.emplace_back( fc::variant(data) );
+      }
+   });
+   return result;
+}
+
+string read_only::get_table_rows_json( const read_only::get_table_rows_params& p )const {
+   string result = "{\"rows\":[";
+   const auto abis = get_abi_serializer( db, p.code, abi_serializer_max_time );
+
+   bool first = true;
+   bool more = walk_table_rows( p, [&]( const vector<char>& data ) {
+      if( !first )
+         result += ',';
+      first = false;
+      if( p.json ) {
+         abis->binary_to_json( abis->get_table_type(p.table), data, result, abi_serializer_max_time );
+      } else {
+         result += fc::json::to_string( fc::variant(data) );
+      }
+   });
+   result += more ? "],\"more\":true}" : "],\"more\":false}";
+   return result;
+}
+
 vector<asset> read_only::get_currency_balance( const read_only::get_currency_balance_params& p )const {
 
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-   auto table_type = get_table_type( abi, "accounts" );
+   get_table_type( *get_abi_serializer( db, p.code, abi_serializer_max_time ), N(accounts) );
 
    vector<asset> results;
    walk_key_value_table(p.code, p.account, N(accounts), [&](const key_value_object& obj){
@@ -1117,8 +1195,7 @@ vector<asset> read_only::get_currency_balance( const read_only::get_currency_bal
 fc::variant read_only::get_currency_stats( const read_only::get_currency_stats_params& p )const {
    fc::mutable_variant_object results;
 
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-   auto table_type = get_table_type( abi, "stat" );
+   get_table_type( *get_abi_serializer( db, p.code, abi_serializer_max_time ), N(stat) );
 
    uint64_t scope = ( eosio::chain::string_to_symbol( 0, boost::algorithm::to_upper_copy(p.symbol).c_str() ) >> 8 );
 
@@ -1145,8 +1222,8 @@ static float64_t to_softfloat64( double d ) {
    return *reinterpret_cast<float64_t*>(&d);
 }
 
-static fc::variant get_global_row( const database& db, const abi_def& abi, const abi_serializer& abis, const fc::microseconds& abi_serializer_max_time_ms ) {
-   const auto table_type = get_table_type(abi, N(global));
+static fc::variant get_global_row( const database& db, const abi_serializer& abis, const fc::microseconds& abi_serializer_max_time_ms ) {
+   const auto table_type = get_table_type(abis, N(global));
    EOS_ASSERT(table_type == read_only::KEYi64, chain::contract_table_query_exception, "Invalid table type ${type} for table global", ("type",table_type));
 
    const auto* const table_id = db.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(N(eosio), N(eosio), N(global)));
@@ -1162,9 +1239,9 @@ static fc::variant get_global_row( const database& db, const abi_def& abi, const
 }
 
 read_only::get_producers_result read_only::get_producers( const read_only::get_producers_params& p ) const {
-   const abi_def abi = eosio::chain_apis::get_abi(db, N(eosio));
-   const auto table_type = get_table_type(abi, N(producers));
-   const abi_serializer abis{ abi, abi_serializer_max_time };
+   const auto abis_ptr = get_abi_serializer(db, N(eosio), abi_serializer_max_time);
+   const abi_serializer& abis = *abis_ptr;
+   const auto table_type = get_table_type(abis, N(producers));
    EOS_ASSERT(table_type == KEYi64, chain::contract_table_query_exception, "Invalid table type ${type} for table producers", ("type",table_type));
 
    const auto& d = db.db();
@@ -1206,7 +1283,7 @@ read_only::get_producers_result read_only::get_producers( const read_only::get_p
          result.rows.emplace_back(fc::variant(data));
    }
 
-   result.total_producer_vote_weight = get_global_row(d, abi, abis, abi_serializer_max_time)["total_producer_vote_weight"].as_double();
+   result.total_producer_vote_weight = get_global_row(d, abis, abi_serializer_max_time)["total_producer_vote_weight"].as_double();
    return result;
 }
 
@@ -1224,16 +1301,10 @@ read_only::get_producer_schedule_result read_only::get_producer_schedule( const
 template<typename Api>
 struct resolver_factory {
    static auto make(const Api* api, const fc::microseconds& max_serialization_time) {
-      return [api, max_serialization_time](const account_name &name) -> optional<abi_serializer> {
-         const auto* accnt = api->db.db().template find<account_object, by_name>(name);
-         if (accnt != nullptr) {
-            abi_def abi;
-            if (abi_serializer::to_abi(accnt->abi, abi)) {
-               return abi_serializer(abi, max_serialization_time);
-            }
-         }
-
-         return optional<abi_serializer>();
+      return [api, max_serialization_time](const account_name &name) -> abi_serializer_ptr {
+         if (api->db.db().template find<account_object, by_name>(name) == nullptr)
+            return abi_serializer_ptr();
+         return api->db.get_abi_serializer(name, max_serialization_time);
       };
    }
 };
@@ -1529,11 +1600,8 @@ read_only::get_account_results read_only::get_account( const get_account_params&
       ++perm;
    }
 
-   const auto& code_account = db.db().get<account_object,by_name>( N(eosio) );
-
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( const auto abis_ptr = db.get_abi_serializer( N(eosio), abi_serializer_max_time ) ) {
+      const abi_serializer& abis = *abis_ptr;
 
       const auto token_code = N(eosio.token);
 
@@ -1599,11 +1667,10 @@ read_only::get_account_results read_only::get_account( const get_account_params&
    return result;
 }
 
-static variant action_abi_to_variant( const abi_def& abi, type_name action_type ) {
+static variant action_abi_to_variant( const abi_serializer& abis, type_name action_type ) {
    variant v;
-   auto it = std::find_if(abi.structs.begin(), abi.structs.end(), [&](auto& x){return x.name == action_type;});
-   if( it != abi.structs.end() )
-      to_variant( it->fields,  v );
+   if( abis.is_struct(action_type) )
+      to_variant( abis.get_struct(action_type).fields,  v );
    return v;
 };
 
@@ -1612,16 +1679,15 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    EOS_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( const auto abis_ptr = db.get_abi_serializer( params.code, abi_serializer_max_time ) ) {
+      const abi_serializer& abis = *abis_ptr;
       auto action_type = abis.get_action_type(params.action);
       EOS_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
       try {
          result.binargs = abis.variant_to_binary(action_type, params.args, abi_serializer_max_time);
       } EOS_RETHROW_EXCEPTIONS(chain::invalid_action_args_exception,
                                 "'${args}' is invalid args for action '${action}' code '${code}'. expected '${proto}'",
-                                ("args", params.args)("action", params.action)("code", params.code)("proto", action_abi_to_variant(abi, action_type)))
+                                ("args", params.args)("action", params.action)("code", params.code)("proto", action_abi_to_variant(abis, action_type)))
    } else {
       EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
    }
@@ -1631,11 +1697,9 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
 
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
    abi_bin_to_json_result result;
-   const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
-      result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time );
+   db.get_account( params.code ); // throws if the account does not exist
+   if( const auto abis = db.get_abi_serializer( params.code, abi_serializer_max_time ) ) {
+      result.args = abis->binary_to_variant( abis->get_action_type( params.action ), params.binargs, abi_serializer_max_time );
    } else {
       EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
    }
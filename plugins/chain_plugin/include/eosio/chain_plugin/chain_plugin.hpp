@@ -35,6 +35,7 @@ namespace eosio {
    using chain::account_name;
    using chain::abi_def;
    using chain::abi_serializer;
+   using chain::abi_serializer_ptr;
 
 namespace chain_apis {
 struct empty{};
@@ -91,6 +92,13 @@ public:
    };
    get_info_results get_info(const get_info_params&) const;
 
+   using get_block_timing_params = empty;
+
+   struct get_block_timing_results {
+      vector<chain::block_stage_timing> stages;
+   };
+   get_block_timing_results get_block_timing(const get_block_timing_params&) const;
+
    struct producer_info {
       name                       producer_name;
    };
@@ -236,6 +244,12 @@ public:
 
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
 
+   /**
+    *  Same as get_table_rows, but returns the JSON text of the result. Rows are written straight from their
+    *  binary form, so large scans do not build a variant for every row and field.
+    */
+   string get_table_rows_json( const get_table_rows_params& params )const;
+
    struct get_currency_balance_params {
       name             code;
       name             account;
@@ -322,15 +336,20 @@ public:
 
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
-   template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
-      read_only::get_table_rows_result result;
+   /**
+    *  Calls on_row with the packed bytes of every row selected by p, returns true if there are more rows
+    *  than the limit or the time allowed for one request let through.
+    */
+   template<typename RowFn>
+   bool walk_table_rows( const read_only::get_table_rows_params& p, RowFn&& on_row )const;
+
+   template <typename IndexType, typename SecKeyType, typename ConvFn, typename RowFn>
+   bool walk_table_rows_by_seckey( const read_only::get_table_rows_params& p, ConvFn conv, RowFn&& on_row )const {
+      bool more = false;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -374,33 +393,26 @@ public:
             const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary>(boost::make_tuple(t_id->id, itr->primary_key));
             if (itr2 == nullptr) continue;
             copy_inline_row(*itr2, data);
-
-            if (p.json) {
-               result.rows.emplace_back(abis.binary_to_variant(abis.get_table_type(p.table), data, abi_serializer_max_time));
-            } else {
-               result.rows.emplace_back(fc::variant(data));
-            }
+            on_row(data);
 
             if (++count == p.limit || fc::time_point::now() > end) {
                break;
             }
          }
          if (itr != upper) {
-            result.more = true;
+            more = true;
          }
       }
-      return result;
+      return more;
    }
 
-   template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
-      read_only::get_table_rows_result result;
+   template <typename IndexType, typename RowFn>
+   bool walk_table_rows_ex( const read_only::get_table_rows_params& p, RowFn&& on_row )const {
+      bool more = false;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
       if (t_id != nullptr) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -435,22 +447,17 @@ public:
          auto itr = lower;
          for (; itr != upper; ++itr) {
             copy_inline_row(*itr, data);
-
-            if (p.json) {
-               result.rows.emplace_back(abis.binary_to_variant(abis.get_table_type(p.table), data, abi_serializer_max_time));
-            } else {
-               result.rows.emplace_back(fc::variant(data));
-            }
+            on_row(data);
 
             if (++count == p.limit || fc::time_point::now() > end) {
                break;
             }
          }
          if (itr != upper) {
-            result.more = true;
+            more = true;
          }
       }
-      return result;
+      return more;
    }
 
    friend struct resolver_factory<read_only>;
@@ -542,6 +549,7 @@ FC_REFLECT( eosio::chain_apis::permission, (perm_name)(parent)(required_auth) )
 FC_REFLECT(eosio::chain_apis::empty, )
 FC_REFLECT(eosio::chain_apis::read_only::get_info_results,
 (server_version)(chain_id)(head_block_num)(last_irreversible_block_num)(last_irreversible_block_id)(head_block_id)(head_block_time)(head_block_producer)(virtual_block_cpu_limit)(virtual_block_net_limit)(block_cpu_limit)(block_net_limit) )
+FC_REFLECT(eosio::chain_apis::read_only::get_block_timing_results, (stages) )
 FC_REFLECT(eosio::chain_apis::read_only::get_block_params, (block_num_or_id))
 FC_REFLECT(eosio::chain_apis::read_only::get_block_header_state_params, (block_num_or_id))
 
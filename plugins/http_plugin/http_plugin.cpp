@@ -89,7 +89,12 @@ namespace eosio {
 
    class http_plugin_impl {
       public:
-         map<string,url_handler>  url_handlers;
+         struct registered_handler {
+            url_handler                                    handler;
+            std::shared_ptr<utilities::latency_histogram>  latency; ///< shared with responses still in flight
+         };
+
+         map<string,registered_handler>  url_handlers;
          optional<tcp::endpoint>  listen_endpoint;
          string                   access_control_allow_origin;
          string                   access_control_allow_headers;
@@ -232,7 +237,9 @@ namespace eosio {
                auto handler_itr = url_handlers.find( resource );
                if( handler_itr != url_handlers.end()) {
                   con->defer_http_response();
-                  handler_itr->second( resource, body, [con]( auto code, auto&& body ) {
+                  auto start = fc::time_point::now();
+                  handler_itr->second.handler( resource, body, [con, start, latency = handler_itr->second.latency]( auto code, auto&& body ) {
+                     latency->observe( (fc::time_point::now() - start).count() );
                      con->set_body( std::move( body ));
                      con->set_status( websocketpp::http::status_code::value( code ));
                      con->send_http_response();
@@ -446,10 +453,19 @@ namespace eosio {
    void http_plugin::add_handler(const string& url, const url_handler& handler) {
       ilog( "add api url: ${c}", ("c",url) );
       app().get_io_service().post([=](){
-        my->url_handlers.insert(std::make_pair(url,handler));
+        my->url_handlers.insert(std::make_pair(url, http_plugin_impl::registered_handler{handler, std::make_shared<utilities::latency_histogram>()}));
       });
    }
 
+   vector<http_plugin::endpoint_latency> http_plugin::get_request_latencies()const {
+      vector<endpoint_latency> result;
+      result.reserve( my->url_handlers.size() );
+      for( const auto& h : my->url_handlers ) {
+         result.push_back( endpoint_latency{ h.first, h.second.latency->get() } );
+      }
+      return result;
+   }
+
    void http_plugin::handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb ) {
       try {
          try {
@@ -4,6 +4,7 @@
  */
 #pragma once
 #include <appbase/application.hpp>
+#include <eosio/utilities/metrics.hpp>
 #include <fc/exception/exception.hpp>
 
 #include <fc/reflect/reflect.hpp>
@@ -79,6 +80,14 @@ namespace eosio {
         bool is_on_loopback() const;
         bool is_secure() const;
 
+        struct endpoint_latency {
+           string                                  url;
+           utilities::latency_histogram::snapshot  latency; ///< from dispatch to the handler until its response
+        };
+
+        /// must be called from the application thread, which is the one registering the handlers
+        vector<endpoint_latency> get_request_latencies()const;
+
       private:
         std::unique_ptr<class http_plugin_impl> my;
    };
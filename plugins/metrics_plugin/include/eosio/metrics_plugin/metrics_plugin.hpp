@@ -0,0 +1,47 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/http_plugin/http_plugin.hpp>
+#include <eosio/chain_plugin/chain_plugin.hpp>
+
+#include <appbase/application.hpp>
+
+namespace eosio {
+
+using namespace appbase;
+
+/**
+ *  Serves counters, gauges and latency histograms of the chain, net, producer and http plugins at /metrics in
+ *  the Prometheus text exposition format.
+ *
+ *  Counters fed by controller signals and channels are only touched on the application thread, everything else
+ *  is read from the owning plugin when the endpoint is scraped, so nothing is added to the hot paths beyond an
+ *  increment. The net and producer metrics are reported when those plugins are running.
+ */
+class metrics_plugin : public plugin<metrics_plugin> {
+public:
+   APPBASE_PLUGIN_REQUIRES((http_plugin) (chain_plugin))
+
+   metrics_plugin();
+   metrics_plugin(const metrics_plugin&) = delete;
+   metrics_plugin(metrics_plugin&&) = delete;
+   metrics_plugin& operator=(const metrics_plugin&) = delete;
+   metrics_plugin& operator=(metrics_plugin&&) = delete;
+   virtual ~metrics_plugin() override;
+
+   virtual void set_program_options(options_description& cli, options_description& cfg) override {}
+   void plugin_initialize(const variables_map& vm);
+   void plugin_startup();
+   void plugin_shutdown();
+
+   /// the current value of every metric in the Prometheus text format
+   string get_metrics()const;
+
+private:
+   std::unique_ptr<class metrics_plugin_impl> my;
+};
+
+}
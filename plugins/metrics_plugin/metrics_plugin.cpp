@@ -0,0 +1,266 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/metrics_plugin/metrics_plugin.hpp>
+#include <eosio/net_plugin/net_plugin.hpp>
+#include <eosio/producer_plugin/producer_plugin.hpp>
+#include <eosio/chain/plugin_interface.hpp>
+#include <eosio/chain/unapplied_transaction_queue.hpp>
+#include <eosio/utilities/metrics.hpp>
+
+#include <boost/signals2/connection.hpp>
+
+#include <sstream>
+
+namespace eosio {
+
+static appbase::abstract_plugin& _metrics_plugin = app().register_plugin<metrics_plugin>();
+
+using namespace eosio::chain;
+using namespace eosio::chain::plugin_interface;
+using boost::signals2::scoped_connection;
+
+namespace {
+   /// writes metrics in the Prometheus text exposition format, version 0.0.4
+   class prometheus_writer {
+      public:
+         void declare( const char* name, const char* type, const char* help ) {
+            out << "# HELP " << name << ' ' << help << '\n'
+                << "# TYPE " << name << ' ' << type << '\n';
+         }
+
+         template<typename T>
+         void sample( const char* name, T value ) {
+            out << name << ' ' << value << '\n';
+         }
+
+         template<typename T>
+         void sample( const char* name, const char* label, const string& label_value, T value ) {
+            out << name << '{' << label << "=\"" << escape( label_value ) << "\"} " << value << '\n';
+         }
+
+         void histogram( const char* name, const char* label, const string& label_value,
+                         const utilities::latency_histogram::snapshot& h ) {
+            const auto& bounds = utilities::latency_histogram::bounds_us();
+            const string labels = string(label) + "=\"" + escape( label_value ) + "\"";
+            uint64_t cumulative = 0;
+            for( size_t i = 0; i < bounds.size(); ++i ) {
+               cumulative += h.buckets[i];
+               out << name << "_bucket{" << labels << ",le=\"" << bounds[i] / 1e6 << "\"} " << cumulative << '\n';
+            }
+            out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << h.count << '\n'
+                << name << "_sum{" << labels << "} " << h.sum_us / 1e6 << '\n'
+                << name << "_count{" << labels << "} " << h.count << '\n';
+         }
+
+         string str()const { return out.str(); }
+
+      private:
+         static string escape( const string& v ) {
+            string result;
+            result.reserve( v.size() );
+            for( char c : v ) {
+               if( c == '\\' || c == '"' ) {
+                  result += '\\';
+                  result += c;
+               } else if( c == '\n' ) {
+                  result += "\\n";
+               } else {
+                  result += c;
+               }
+            }
+            return result;
+         }
+
+         std::ostringstream out;
+   };
+}
+
+class metrics_plugin_impl {
+   public:
+      struct chain_counters {
+         uint64_t executed = 0;
+         uint64_t soft_fail = 0;
+         uint64_t hard_fail = 0;
+         uint64_t delayed = 0;
+         uint64_t expired = 0;
+         uint64_t cpu_billed_us = 0;
+         uint64_t net_billed_bytes = 0;
+
+         uint64_t incoming_accepted = 0;
+         map<string, uint64_t> incoming_failed; ///< by exception name
+
+         uint64_t fork_switches = 0;
+         uint64_t popped_blocks = 0;
+         uint32_t max_pop_depth = 0;
+      };
+
+      chain_counters                 counters;
+      block_id_type                  last_block_id;
+      uint32_t                       last_block_num = 0;
+
+      fc::optional<scoped_connection> accepted_block_connection;
+      compat::channels::transaction_ack::channel_type::handle incoming_transaction_ack_subscription;
+
+      void on_accepted_block( const block_state_ptr& bsp ) {
+         // every block but the first of a fork switch builds on the previously accepted one
+         if( last_block_num != 0 && bsp->header.previous != last_block_id ) {
+            uint32_t depth = last_block_num >= bsp->block_num ? last_block_num - bsp->block_num + 1 : 0;
+            ++counters.fork_switches;
+            counters.popped_blocks += depth;
+            counters.max_pop_depth = std::max( counters.max_pop_depth, depth );
+         }
+         last_block_id = bsp->id;
+         last_block_num = bsp->block_num;
+
+         for( const auto& r : bsp->block->transactions ) {
+            switch( r.status ) {
+               case transaction_receipt_header::executed:  ++counters.executed;  break;
+               case transaction_receipt_header::soft_fail: ++counters.soft_fail; break;
+               case transaction_receipt_header::hard_fail: ++counters.hard_fail; break;
+               case transaction_receipt_header::delayed:   ++counters.delayed;   break;
+               case transaction_receipt_header::expired:   ++counters.expired;   break;
+            }
+            counters.cpu_billed_us += r.cpu_usage_us;
+            counters.net_billed_bytes += uint64_t(r.net_usage_words) * 8;
+         }
+      }
+
+      void on_transaction_ack( const std::pair<fc::exception_ptr, packed_transaction_ptr>& results ) {
+         if( results.first ) {
+            ++counters.incoming_failed[results.first->name()];
+         } else {
+            ++counters.incoming_accepted;
+         }
+      }
+
+      string render()const;
+};
+
+string metrics_plugin_impl::render()const {
+   auto& chain = app().get_plugin<chain_plugin>().chain();
+   prometheus_writer w;
+
+   w.declare( "eosio_chain_block_transactions_total", "counter", "Transaction receipts in accepted blocks by status" );
+   w.sample( "eosio_chain_block_transactions_total", "status", "executed", counters.executed );
+   w.sample( "eosio_chain_block_transactions_total", "status", "soft_fail", counters.soft_fail );
+   w.sample( "eosio_chain_block_transactions_total", "status", "hard_fail", counters.hard_fail );
+   w.sample( "eosio_chain_block_transactions_total", "status", "delayed", counters.delayed );
+   w.sample( "eosio_chain_block_transactions_total", "status", "expired", counters.expired );
+
+   w.declare( "eosio_chain_cpu_billed_microseconds_total", "counter", "CPU billed by the transactions of accepted blocks" );
+   w.sample( "eosio_chain_cpu_billed_microseconds_total", counters.cpu_billed_us );
+   w.declare( "eosio_chain_net_billed_bytes_total", "counter", "NET billed by the transactions of accepted blocks" );
+   w.sample( "eosio_chain_net_billed_bytes_total", counters.net_billed_bytes );
+
+   w.declare( "eosio_chain_incoming_transactions_accepted_total", "counter", "Incoming transactions that were applied" );
+   w.sample( "eosio_chain_incoming_transactions_accepted_total", counters.incoming_accepted );
+   w.declare( "eosio_chain_incoming_transactions_failed_total", "counter", "Incoming transactions that were rejected, by exception" );
+   for( const auto& f : counters.incoming_failed ) {
+      w.sample( "eosio_chain_incoming_transactions_failed_total", "reason", f.first, f.second );
+   }
+
+   w.declare( "eosio_chain_fork_switches_total", "counter", "Times the head moved to a block that does not build on the previous head" );
+   w.sample( "eosio_chain_fork_switches_total", counters.fork_switches );
+   w.declare( "eosio_chain_popped_blocks_total", "counter", "Blocks undone by fork switches" );
+   w.sample( "eosio_chain_popped_blocks_total", counters.popped_blocks );
+   w.declare( "eosio_chain_max_pop_depth", "gauge", "Most blocks undone by a single fork switch" );
+   w.sample( "eosio_chain_max_pop_depth", counters.max_pop_depth );
+
+   w.declare( "eosio_chain_head_block_num", "gauge", "Head block number" );
+   w.sample( "eosio_chain_head_block_num", chain.head_block_num() );
+   w.declare( "eosio_chain_last_irreversible_block_num", "gauge", "Last irreversible block number" );
+   w.sample( "eosio_chain_last_irreversible_block_num", chain.last_irreversible_block_num() );
+   w.declare( "eosio_chain_unapplied_transactions", "gauge", "Transactions waiting to be applied again after a block was undone" );
+   w.sample( "eosio_chain_unapplied_transactions", chain.get_unapplied_transaction_queue().size() );
+
+   const auto* segment = chain.db().get_segment_manager();
+   w.declare( "eosio_chain_state_free_bytes", "gauge", "Free memory in the chain state database" );
+   w.sample( "eosio_chain_state_free_bytes", segment->get_free_memory() );
+   w.declare( "eosio_chain_state_size_bytes", "gauge", "Size of the chain state database" );
+   w.sample( "eosio_chain_state_size_bytes", segment->get_size() );
+
+   auto wasm = chain.get_wasm_interface().get_cache_stats();
+   w.declare( "eosio_wasm_cache_hits_total", "counter", "Contract executions that found their module instantiated, in the cache or by a background compile" );
+   w.sample( "eosio_wasm_cache_hits_total", wasm.hits );
+   w.declare( "eosio_wasm_cache_misses_total", "counter", "Contract executions that compiled their module before running" );
+   w.sample( "eosio_wasm_cache_misses_total", wasm.misses );
+   w.declare( "eosio_wasm_compiles_total", "counter", "Contracts compiled and instantiated, in the background or on a cache miss" );
+   w.sample( "eosio_wasm_compiles_total", wasm.compiles );
+   w.declare( "eosio_wasm_compile_microseconds_total", "counter", "Time spent compiling and instantiating contracts" );
+   w.sample( "eosio_wasm_compile_microseconds_total", wasm.compile_time );
+   w.declare( "eosio_wasm_cache_evictions_total", "counter", "Instantiated contracts dropped from the cache" );
+   w.sample( "eosio_wasm_cache_evictions_total", wasm.evictions );
+   w.declare( "eosio_wasm_cache_entries", "gauge", "Instantiated contracts in the cache" );
+   w.sample( "eosio_wasm_cache_entries", wasm.entries );
+   w.declare( "eosio_wasm_cache_code_bytes", "gauge", "Code size of the instantiated contracts in the cache" );
+   w.sample( "eosio_wasm_cache_code_bytes", wasm.code_size );
+
+   auto* net = app().find_plugin<net_plugin>();
+   if( net && net->get_state() == abstract_plugin::started ) {
+      auto peers = net->connections();
+      w.declare( "eosio_net_peers", "gauge", "Connections to other nodes" );
+      w.sample( "eosio_net_peers", peers.size() );
+      w.declare( "eosio_net_peer_received_bytes_total", "counter", "Bytes received from a peer" );
+      for( const auto& p : peers )
+         w.sample( "eosio_net_peer_received_bytes_total", "peer", p.peer, p.bytes_received );
+      w.declare( "eosio_net_peer_sent_bytes_total", "counter", "Bytes sent to a peer" );
+      for( const auto& p : peers )
+         w.sample( "eosio_net_peer_sent_bytes_total", "peer", p.peer, p.bytes_sent );
+      w.declare( "eosio_net_peer_write_queue", "gauge", "Messages queued or being written to a peer" );
+      for( const auto& p : peers )
+         w.sample( "eosio_net_peer_write_queue", "peer", p.peer, p.write_queue_size );
+   }
+
+   auto* producer = app().find_plugin<producer_plugin>();
+   if( producer && producer->get_state() == abstract_plugin::started ) {
+      auto sb = producer->get_start_block_metrics();
+      w.declare( "eosio_producer_start_block_total", "counter", "Pending blocks started by the production loop, by outcome" );
+      w.sample( "eosio_producer_start_block_total", "result", "succeeded", sb.succeeded );
+      w.sample( "eosio_producer_start_block_total", "result", "failed", sb.failed );
+      w.sample( "eosio_producer_start_block_total", "result", "waiting", sb.waiting );
+      w.sample( "eosio_producer_start_block_total", "result", "exhausted", sb.exhausted );
+   }
+
+   w.declare( "eosio_http_request_duration_seconds", "histogram", "Time from dispatching an HTTP request to its response, by endpoint" );
+   for( const auto& e : app().get_plugin<http_plugin>().get_request_latencies() ) {
+      w.histogram( "eosio_http_request_duration_seconds", "endpoint", e.url, e.latency );
+   }
+
+   return w.str();
+}
+
+metrics_plugin::metrics_plugin():my(new metrics_plugin_impl()){}
+metrics_plugin::~metrics_plugin(){}
+
+void metrics_plugin::plugin_initialize(const variables_map& vm) {
+   auto& chain = app().get_plugin<chain_plugin>().chain();
+   my->accepted_block_connection.emplace( chain.accepted_block.connect( [this]( const block_state_ptr& bsp ) {
+      my->on_accepted_block( bsp );
+   } ));
+   my->incoming_transaction_ack_subscription = app().get_channel<compat::channels::transaction_ack>().subscribe(
+      [this]( const std::pair<fc::exception_ptr, packed_transaction_ptr>& results ) {
+         my->on_transaction_ack( results );
+      } );
+}
+
+void metrics_plugin::plugin_startup() {
+   app().get_plugin<http_plugin>().add_handler( "/metrics", [this]( string, string, url_response_callback cb ) {
+      try {
+         cb( 200, get_metrics() );
+      } catch (...) {
+         http_plugin::handle_exception( "metrics", "get", "", cb );
+      }
+   } );
+}
+
+void metrics_plugin::plugin_shutdown() {
+   my->accepted_block_connection.reset();
+}
+
+string metrics_plugin::get_metrics()const {
+   return my->render();
+}
+
+}
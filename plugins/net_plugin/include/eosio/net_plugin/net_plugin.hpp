@@ -15,6 +15,9 @@ namespace eosio {
       bool              connecting = false;
       bool              syncing    = false;
       handshake_message last_handshake;
+      uint64_t          bytes_received = 0;
+      uint64_t          bytes_sent = 0;
+      uint64_t          write_queue_size = 0; ///< messages queued or being written to the peer
    };
 
    class net_plugin : public appbase::plugin<net_plugin>
@@ -44,4 +47,4 @@ namespace eosio {
 
 }
 
-FC_REFLECT( eosio::connection_status, (peer)(connecting)(syncing)(last_handshake) )
+FC_REFLECT( eosio::connection_status, (peer)(connecting)(syncing)(last_handshake)(bytes_received)(bytes_sent)(write_queue_size) )
@@ -27,8 +27,13 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/intrusive/set.hpp>
 
+#include <atomic>
+#include <thread>
+
 using namespace eosio::chain::plugin_interface::compat;
 
 namespace fc {
@@ -63,6 +68,12 @@ namespace eosio {
 
    using net_message_ptr = shared_ptr<net_message>;
 
+   /**
+    * A fully framed message (length prefix followed by the packed net_message). Buffers are immutable once
+    * built, so one buffer is shared by every connection a message is sent to.
+    */
+   using send_buffer_type = std::shared_ptr<const vector<char>>;
+
    template<typename I>
    std::string itoh(I n, size_t hlen = sizeof(I)<<1) {
       static const char* digits = "0123456789abcdef";
@@ -78,7 +89,7 @@ namespace eosio {
                                 /// Expires increased while the txn is
                                 /// "in flight" to anoher peer
       packed_transaction packed_txn;
-      vector<char>    serialized_txn; /// the received raw bundle
+      send_buffer_type serialized_txn; /// the framed message, shared by every peer it is sent to
       uint32_t        block_num = 0; /// block transaction was included in
       uint32_t        true_block = 0; /// used to reset block_uum when request is 0
       uint16_t        requests = 0; /// the number of "in flight" requests for this txn
@@ -151,6 +162,17 @@ namespace eosio {
 
       connection_ptr find_connection( string host )const;
 
+      /**
+       * Sockets live on this io_context and every socket operation and message decode runs on its threads,
+       * serialized per connection by the connection's strand. Decoded messages and all connection state
+       * are handled on the application thread. Declared before anything holding connections so that it
+       * outlives their sockets.
+       */
+      uint16_t                                   thread_pool_size = def_thread_pool_size;
+      unique_ptr<boost::asio::io_context>        thread_pool_ioc;
+      optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> thread_pool_work;
+      vector<std::thread>                        thread_pool;
+
       std::set< connection_ptr >       connections;
       bool                             done = false;
       unique_ptr< sync_manager >       sync_master;
@@ -184,15 +206,21 @@ namespace eosio {
 
       void connect( connection_ptr c );
       void connect( connection_ptr c, tcp::resolver::iterator endpoint_itr );
+      void connect_complete( const connection_wptr& c, tcp::resolver::iterator endpoint_itr, const boost::system::error_code& err );
       bool start_session( connection_ptr c );
       void start_listen_loop( );
       void start_read_message( connection_ptr c);
+      void read_message( connection_ptr c );
 
       void   close( connection_ptr c );
+      /// close from a net thread, connections are only closed on the application thread
+      void   post_close( connection_ptr c );
       size_t count_open_sockets() const;
 
       template<typename VerifierFunc>
       void send_all( const net_message &msg, VerifierFunc verify );
+      template<typename VerifierFunc>
+      void send_all( const send_buffer_type& send_buffer, VerifierFunc verify );
 
       void accepted_block_header(const block_state_ptr&);
       void accepted_block(const block_state_ptr&);
@@ -319,6 +347,10 @@ namespace eosio {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_block_buffer_cache_size = 32; // framed blocks kept for broadcasts and requests near the head
+   constexpr uint16_t def_thread_pool_size = 2; // threads for socket io and message decoding
+   constexpr uint32_t def_max_pending_messages = 1000; // decoded messages of one peer waiting for the application thread before its reads pause
+   constexpr uint32_t def_resume_pending_messages = def_max_pending_messages / 2; // reads resume once the backlog drains to this
    constexpr uint32_t  def_max_just_send = 1500; // roughly 1 "mtu"
    constexpr bool     large_msg_notify = false;
 
@@ -473,17 +505,29 @@ namespace eosio {
       transaction_state_index trx_state;
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
       socket_ptr              socket;
+      boost::asio::strand<boost::asio::io_context::executor_type> strand; ///< serializes socket operations
 
       fc::message_buffer<1024*1024>    pending_message_buffer;
       fc::optional<std::size_t>        outstanding_read_bytes;
-      vector<char>            blk_buffer;
+      /// decoded messages posted to the application thread and not yet handled, incremented on the strand
+      std::atomic<uint32_t>            pending_messages{0};
+      bool                             read_paused = false; ///< strand only, set while pending_messages is too high to read more
 
       struct queued_write {
-         std::shared_ptr<vector<char>> buff;
+         send_buffer_type buff;
          std::function<void(boost::system::error_code, std::size_t)> callback;
       };
       deque<queued_write>     write_queue;
       deque<queued_write>     out_queue;
+      std::atomic<uint64_t>   bytes_received{0}; ///< updated on the connection strand by the read loop
+      std::atomic<uint64_t>   bytes_sent{0};     ///< updated on the application thread by write_complete
+      /**
+       * Application thread view of the socket. The socket itself is closed later on the strand, so the
+       * application thread checks this instead of socket->is_open(). Outbound connections start closed
+       * and are opened when a connect is started.
+       */
+      bool                    closed = true;
+      boost::asio::ip::address remote_address; ///< of accepted connections, recorded on the application thread
       fc::sha256              node_id;
       handshake_message       last_handshake_recv;
       handshake_message       last_handshake_sent;
@@ -505,6 +549,9 @@ namespace eosio {
          stat.connecting = connecting;
          stat.syncing = syncing;
          stat.last_handshake = last_handshake_recv;
+         stat.bytes_received = bytes_received.load( std::memory_order_relaxed );
+         stat.bytes_sent = bytes_sent.load( std::memory_order_relaxed );
+         stat.write_queue_size = write_queue.size() + out_queue.size();
          return stat;
       }
 
@@ -530,6 +577,8 @@ namespace eosio {
       void reset();
       void close();
       void send_handshake();
+      /// called on the application thread after a decoded message was handled or dropped
+      void message_handled();
 
       /** \name Peer Timestamps
        *  Time message handling
@@ -567,6 +616,8 @@ namespace eosio {
       void stop_send();
 
       void enqueue( const net_message &msg, bool trigger_send = true );
+      void enqueue_block( const signed_block_ptr& b, bool trigger_send = true, bool cache_buffer = true );
+      void enqueue_buffer( const send_buffer_type& send_buffer, bool trigger_send, go_away_reason close_after_send );
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -578,10 +629,12 @@ namespace eosio {
       void sync_timeout(boost::system::error_code ec);
       void fetch_timeout(boost::system::error_code ec);
 
-      void queue_write(std::shared_ptr<vector<char>> buff,
+      void queue_write(const send_buffer_type& buff,
                        bool trigger_send,
                        std::function<void(boost::system::error_code, std::size_t)> callback);
       void do_queue_write();
+      /// runs on the application thread once the queued buffers have been written
+      static void write_complete(const connection_wptr& c, boost::system::error_code ec, std::size_t w);
 
       /** \brief Process the next message from the pending message buffer
        *
@@ -678,12 +731,20 @@ namespace eosio {
 
       std::multimap<block_id_type, connection_ptr> received_blocks;
       std::multimap<transaction_id_type, connection_ptr> received_transactions;
+      deque<std::pair<block_id_type, send_buffer_type>> block_buffers; ///< most recently used first
 
       void bcast_transaction (const packed_transaction& msg);
       void rejected_transaction (const transaction_id_type& msg);
-      void bcast_block (const signed_block& msg);
+      void bcast_block (const signed_block_ptr& msg);
       void rejected_block (const block_id_type &id);
 
+      /**
+       * framed message for the block, shared by every connection it is sent to. Blocks read only to serve a
+       * syncing peer are looked up but not added (cache_result = false), so they cannot push out the buffers
+       * of recent broadcasts.
+       */
+      send_buffer_type block_send_buffer (const signed_block_ptr& b, bool cache_result = true);
+
       void recv_block (connection_ptr conn, const block_id_type& msg, uint32_t bnum);
       void recv_transaction(connection_ptr conn, const transaction_id_type& id);
       void recv_notice (connection_ptr conn, const notice_message& msg, bool generated);
@@ -697,7 +758,8 @@ namespace eosio {
       : blk_state(),
         trx_state(),
         peer_requested(),
-        socket( std::make_shared<tcp::socket>( std::ref( app().get_io_service() ))),
+        socket( std::make_shared<tcp::socket>( std::ref( *my_impl->thread_pool_ioc ))),
+        strand( my_impl->thread_pool_ioc->get_executor() ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -722,6 +784,7 @@ namespace eosio {
         trx_state(),
         peer_requested(),
         socket( s ),
+        strand( my_impl->thread_pool_ioc->get_executor() ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -738,6 +801,7 @@ namespace eosio {
         last_req()
    {
       wlog( "accepted network connection" );
+      closed = false;
       initialize();
    }
 
@@ -750,7 +814,7 @@ namespace eosio {
    }
 
    bool connection::connected() {
-      return (socket && socket->is_open() && !connecting);
+      return (socket && !closed && !connecting);
    }
 
    bool connection::current() {
@@ -768,8 +832,14 @@ namespace eosio {
    }
 
    void connection::close() {
+      closed = true;
       if(socket) {
-         socket->close();
+         boost::asio::post( strand, [self = shared_from_this()]() {
+            boost::system::error_code ec;
+            self->socket->close( ec );
+            self->outstanding_read_bytes.reset();
+            self->pending_message_buffer.reset();
+         });
       }
       else {
          wlog("no socket to close!");
@@ -787,12 +857,11 @@ namespace eosio {
       my_impl->sync_master->reset_lib_num(shared_from_this());
       fc_dlog(logger, "canceling wait on ${p}", ("p",peer_name()));
       cancel_wait();
-      pending_message_buffer.reset();
    }
 
    void connection::txn_send_pending(const vector<transaction_id_type> &ids) {
       for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
-         if(tx->serialized_txn.size() && tx->block_num == 0) {
+         if(tx->serialized_txn && tx->block_num == 0) {
             bool found = false;
             for(auto known : ids) {
                if( known == tx->id) {
@@ -802,7 +871,7 @@ namespace eosio {
             }
             if(!found) {
                my_impl->local_txns.modify(tx,incr_in_flight);
-               queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+               queue_write(tx->serialized_txn,
                            true,
                            [tx_id=tx->id](boost::system::error_code ec, std::size_t ) {
                               auto& local_txns = my_impl->local_txns;
@@ -821,9 +890,9 @@ namespace eosio {
    void connection::txn_send(const vector<transaction_id_type> &ids) {
       for(auto t : ids) {
          auto tx = my_impl->local_txns.get<by_id>().find(t);
-         if( tx != my_impl->local_txns.end() && tx->serialized_txn.size()) {
+         if( tx != my_impl->local_txns.end() && tx->serialized_txn) {
             my_impl->local_txns.modify( tx,incr_in_flight);
-            queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+            queue_write(tx->serialized_txn,
                         true,
                         [t](boost::system::error_code ec, std::size_t ) {
                            auto& local_txns = my_impl->local_txns;
@@ -888,7 +957,7 @@ namespace eosio {
          if (bstack.back()->previous == lib_id) {
             count = bstack.size();
             while (bstack.size()) {
-               enqueue(*bstack.back());
+               enqueue_block(bstack.back());
                bstack.pop_back();
             }
          }
@@ -909,7 +978,7 @@ namespace eosio {
             signed_block_ptr b = cc.fetch_block_by_id(blkid);
             if(b) {
                fc_dlog(logger,"found block for id at num ${n}",("n",b->block_num()));
-               enqueue(net_message(*b));
+               enqueue_block(b);
             }
             else {
                ilog("fetch block by id returned null, id ${id} on block ${c} of ${s} for ${p}",
@@ -969,7 +1038,7 @@ namespace eosio {
       enqueue(xpkt);
    }
 
-   void connection::queue_write(std::shared_ptr<vector<char>> buff,
+   void connection::queue_write(const send_buffer_type& buff,
                                 bool trigger_send,
                                 std::function<void(boost::system::error_code, std::size_t)> callback) {
       write_queue.push_back({buff, callback});
@@ -981,61 +1050,76 @@ namespace eosio {
       if(write_queue.empty() || !out_queue.empty())
          return;
       connection_wptr c(shared_from_this());
-      if(!socket->is_open()) {
+      if(closed) {
          fc_elog(logger,"socket not open to ${p}",("p",peer_name()));
          my_impl->close(c.lock());
          return;
       }
       std::vector<boost::asio::const_buffer> bufs;
+      vector<send_buffer_type> buffs; // keeps the data alive on the net thread even if the connection goes away
       while (write_queue.size() > 0) {
          auto& m = write_queue.front();
          bufs.push_back(boost::asio::buffer(*m.buff));
+         buffs.push_back(m.buff);
          out_queue.push_back(m);
          write_queue.pop_front();
       }
-      boost::asio::async_write(*socket, bufs, [c](boost::system::error_code ec, std::size_t w) {
-            try {
-               auto conn = c.lock();
-               if(!conn)
-                  return;
+      boost::asio::post(strand, [c, socket=socket, bufs=std::move(bufs), buffs=std::move(buffs)]() mutable {
+         auto conn = c.lock();
+         if(!conn)
+            return;
+         boost::asio::async_write(*socket, bufs, boost::asio::bind_executor(conn->strand,
+            [c, socket, buffs=std::move(buffs)](boost::system::error_code ec, std::size_t w) {
+               app().get_io_service().post([c, ec, w]() {
+                  connection::write_complete(c, ec, w);
+               });
+            }));
+      });
+   }
 
-               for (auto& m: conn->out_queue) {
-                  m.callback(ec, w);
-               }
+   void connection::write_complete(const connection_wptr& c, boost::system::error_code ec, std::size_t w) {
+      try {
+         auto conn = c.lock();
+         if(!conn)
+            return;
 
-               if(ec) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  if( ec.value() != boost::asio::error::eof) {
-                     elog("Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()));
-                  }
-                  else {
-                     ilog("connection closure detected on write to ${p}",("p",pname));
-                  }
-                  my_impl->close(conn);
-                  return;
-               }
-               while (conn->out_queue.size() > 0) {
-                  conn->out_queue.pop_front();
-               }
-               conn->enqueue_sync_block();
-               conn->do_queue_write();
-            }
-            catch(const std::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()));
-            }
-            catch(const fc::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()));
+         for (auto& m: conn->out_queue) {
+            m.callback(ec, w);
+         }
+
+         if(ec) {
+            string pname = conn ? conn->peer_name() : "no connection name";
+            if( ec.value() != boost::asio::error::eof) {
+               elog("Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()));
             }
-            catch(...) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p}", ("p",pname) );
+            else {
+               ilog("connection closure detected on write to ${p}",("p",pname));
             }
-         });
+            my_impl->close(conn);
+            return;
+         }
+         conn->bytes_sent.fetch_add(w, std::memory_order_relaxed);
+         while (conn->out_queue.size() > 0) {
+            conn->out_queue.pop_front();
+         }
+         conn->enqueue_sync_block();
+         conn->do_queue_write();
+      }
+      catch(const std::exception &ex) {
+         auto conn = c.lock();
+         string pname = conn ? conn->peer_name() : "no connection name";
+         elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()));
+      }
+      catch(const fc::exception &ex) {
+         auto conn = c.lock();
+         string pname = conn ? conn->peer_name() : "no connection name";
+         elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()));
+      }
+      catch(...) {
+         auto conn = c.lock();
+         string pname = conn ? conn->peer_name() : "no connection name";
+         elog("Exception in do_queue_write to ${p}", ("p",pname) );
+      }
    }
 
    void connection::cancel_sync(go_away_reason reason) {
@@ -1068,7 +1152,7 @@ namespace eosio {
       try {
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
-            enqueue( *sb, trigger_send);
+            enqueue_block( sb, trigger_send, false );
             return true;
          }
       } catch ( ... ) {
@@ -1077,12 +1161,7 @@ namespace eosio {
       return false;
    }
 
-   void connection::enqueue( const net_message &m, bool trigger_send ) {
-      go_away_reason close_after_send = no_reason;
-      if (m.contains<go_away_message>()) {
-         close_after_send = m.get<go_away_message>().reason;
-      }
-
+   static send_buffer_type create_send_buffer( const net_message& m ) {
       uint32_t payload_size = fc::raw::pack_size( m );
       char * header = reinterpret_cast<char*>(&payload_size);
       size_t header_size = sizeof(payload_size);
@@ -1093,6 +1172,23 @@ namespace eosio {
       fc::datastream<char*> ds( send_buffer->data(), buffer_size);
       ds.write( header, header_size );
       fc::raw::pack( ds, m );
+      return send_buffer;
+   }
+
+   void connection::enqueue( const net_message &m, bool trigger_send ) {
+      go_away_reason close_after_send = no_reason;
+      if (m.contains<go_away_message>()) {
+         close_after_send = m.get<go_away_message>().reason;
+      }
+
+      enqueue_buffer( create_send_buffer( m ), trigger_send, close_after_send );
+   }
+
+   void connection::enqueue_block( const signed_block_ptr& b, bool trigger_send, bool cache_buffer ) {
+      enqueue_buffer( my_impl->dispatcher->block_send_buffer( b, cache_buffer ), trigger_send, no_reason );
+   }
+
+   void connection::enqueue_buffer( const send_buffer_type& send_buffer, bool trigger_send, go_away_reason close_after_send ) {
       connection_wptr weak_this = shared_from_this();
       queue_write(send_buffer,trigger_send,
                   [weak_this, close_after_send](boost::system::error_code ec, std::size_t ) {
@@ -1185,37 +1281,49 @@ namespace eosio {
       sync_wait();
    }
 
+   /**
+    * Runs on the connection's strand. The message is decoded on the net thread and handed to the
+    * application thread, in order, for handling.
+    */
    bool connection::process_next_message(net_plugin_impl& impl, uint32_t message_length) {
       try {
-         // If it is a signed_block, then save the raw message for the cache
-         // This must be done before we unpack the message.
-         // This code is copied from fc::io::unpack(..., unsigned_int)
-         auto index = pending_message_buffer.read_index();
-         uint64_t which = 0; char b = 0; uint8_t by = 0;
-         do {
-            pending_message_buffer.peek(&b, 1, index);
-            which |= uint32_t(uint8_t(b) & 0x7f) << by;
-            by += 7;
-         } while( uint8_t(b) & 0x80 && by < 32);
-
-         if (which == uint64_t(net_message::tag<signed_block>::value)) {
-            blk_buffer.resize(message_length);
-            auto index = pending_message_buffer.read_index();
-            pending_message_buffer.peek(blk_buffer.data(), message_length, index);
-         }
          auto ds = pending_message_buffer.create_datastream();
          net_message msg;
          fc::raw::unpack(ds, msg);
-         msgHandler m(impl, shared_from_this() );
-         msg.visit(m);
+         pending_messages.fetch_add(1, std::memory_order_relaxed);
+         app().get_io_service().post( [&impl, c = shared_from_this(), msg = std::move(msg)]() mutable {
+            // messages read before the connection was closed are dropped
+            if( !c->closed ) {
+               try {
+                  msgHandler m(impl, c);
+                  msg.visit(m);
+               } catch(  const fc::exception& e ) {
+                  edump((e.to_detail_string() ));
+                  impl.close( c );
+               }
+            }
+            c->message_handled();
+         });
       } catch(  const fc::exception& e ) {
          edump((e.to_detail_string() ));
-         impl.close( shared_from_this() );
+         impl.post_close( shared_from_this() );
          return false;
       }
       return true;
    }
 
+   void connection::message_handled() {
+      // the strand paused reading at def_max_pending_messages, every decrement passes the resume level on the way down
+      if( pending_messages.fetch_sub(1, std::memory_order_relaxed) - 1 == def_resume_pending_messages ) {
+         boost::asio::post( strand, [c = shared_from_this()]() {
+            if( c->read_paused && c->pending_messages.load(std::memory_order_relaxed) < def_max_pending_messages ) {
+               c->read_paused = false;
+               my_impl->read_message( c );
+            }
+         });
+      }
+   }
+
    bool connection::add_peer_block(const peer_block_state &entry) {
       auto bptr = blk_state.get<by_id>().find(entry.id);
       bool added = (bptr == blk_state.end());
@@ -1599,20 +1707,19 @@ namespace eosio {
 
    //------------------------------------------------------------------------
 
-   void dispatch_manager::bcast_block (const signed_block &bsum) {
+   void dispatch_manager::bcast_block (const signed_block_ptr& bsum) {
       std::set<connection_ptr> skips;
-      auto range = received_blocks.equal_range(bsum.id());
+      block_id_type bid = bsum->id();
+      auto range = received_blocks.equal_range(bid);
       for (auto org = range.first; org != range.second; ++org) {
          skips.insert(org->second);
       }
       received_blocks.erase(range.first, range.second);
 
-      net_message msg(bsum);
-      uint32_t packsiz = fc::raw::pack_size(msg);
-      uint32_t msgsiz = packsiz + sizeof(packsiz);
+      send_buffer_type send_buffer = block_send_buffer(bsum);
+      uint32_t msgsiz = send_buffer->size();
       notice_message pending_notify;
-      block_id_type bid = bsum.id();
-      uint32_t bnum = bsum.block_num();
+      uint32_t bnum = bsum->block_num();
       pending_notify.known_blocks.mode = normal;
       pending_notify.known_blocks.ids.push_back( bid );
       pending_notify.known_trx.mode = none;
@@ -1639,9 +1746,32 @@ namespace eosio {
                continue;
             }
             cp->add_peer_block(pbstate);
-            cp->enqueue( bsum );
+            cp->enqueue_buffer( send_buffer, true, no_reason );
+         }
+      }
+   }
+
+   send_buffer_type dispatch_manager::block_send_buffer (const signed_block_ptr& b, bool cache_result) {
+      block_id_type id = b->id();
+      for (auto itr = block_buffers.begin(); itr != block_buffers.end(); ++itr) {
+         if (itr->first == id) {
+            send_buffer_type send_buffer = itr->second;
+            if (itr != block_buffers.begin()) {
+               block_buffers.erase(itr);
+               block_buffers.emplace_front(id, send_buffer);
+            }
+            return send_buffer;
          }
       }
+
+      // on a miss the block is still copied into a net_message to be packed
+      send_buffer_type send_buffer = create_send_buffer(net_message(*b));
+      if (!cache_result)
+         return send_buffer;
+      block_buffers.emplace_front(id, send_buffer);
+      if (block_buffers.size() > def_block_buffer_cache_size)
+         block_buffers.pop_back();
+      return send_buffer;
    }
 
    void dispatch_manager::recv_block (connection_ptr c, const block_id_type& id, uint32_t bnum) {
@@ -1686,27 +1816,19 @@ namespace eosio {
          fc_dlog(logger, "found trxid in local_trxs" );
          return;
       }
-      uint32_t packsiz = 0;
-      uint32_t bufsiz = 0;
-
       time_point_sec trx_expiration = trx.expiration();
 
-      net_message msg(trx);
-      packsiz = fc::raw::pack_size(msg);
-      bufsiz = packsiz + sizeof(packsiz);
-      vector<char> buff(bufsiz);
-      fc::datastream<char*> ds( buff.data(), bufsiz);
-      ds.write( reinterpret_cast<char*>(&packsiz), sizeof(packsiz) );
-      fc::raw::pack( ds, msg );
+      send_buffer_type send_buffer = create_send_buffer(net_message(trx));
+      uint32_t bufsiz = send_buffer->size();
       node_transaction_state nts = {id,
                                     trx_expiration,
                                     trx,
-                                    std::move(buff),
+                                    send_buffer,
                                     0, 0, 0};
       my_impl->local_txns.insert(std::move(nts));
 
       if( !large_msg_notify || bufsiz <= just_send_it_max) {
-         my_impl->send_all( trx, [id, &skips, trx_expiration](connection_ptr c) -> bool {
+         my_impl->send_all( send_buffer, [id, &skips, trx_expiration](connection_ptr c) -> bool {
                if( skips.find(c) != skips.end() || c->syncing ) {
                   return false;
                }
@@ -1936,27 +2058,40 @@ namespace eosio {
       auto current_endpoint = *endpoint_itr;
       ++endpoint_itr;
       c->connecting = true;
+      c->closed = false;
       connection_wptr weak_conn = c;
-      c->socket->async_connect( current_endpoint, [weak_conn, endpoint_itr, this] ( const boost::system::error_code& err ) {
-            auto c = weak_conn.lock();
-            if (!c) return;
-            if( !err && c->socket->is_open() ) {
-               if (start_session( c )) {
-                  c->send_handshake ();
-               }
-            } else {
-               if( endpoint_itr != tcp::resolver::iterator() ) {
-                  close(c);
-                  connect( c, endpoint_itr );
-               }
-               else {
-                  elog( "connection failed to ${peer}: ${error}",
-                        ( "peer", c->peer_name())("error",err.message()));
-                  c->connecting = false;
-                  my_impl->close(c);
-               }
-            }
-         } );
+      boost::asio::post( c->strand, [weak_conn, current_endpoint, endpoint_itr, this]() {
+         auto c = weak_conn.lock();
+         if (!c) return;
+         c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
+            [weak_conn, endpoint_itr, this]( const boost::system::error_code& err ) {
+               app().get_io_service().post( [weak_conn, endpoint_itr, err, this]() {
+                  connect_complete( weak_conn, endpoint_itr, err );
+               });
+            }));
+      });
+   }
+
+   void net_plugin_impl::connect_complete( const connection_wptr& weak_conn, tcp::resolver::iterator endpoint_itr,
+                                           const boost::system::error_code& err ) {
+      auto c = weak_conn.lock();
+      if (!c) return;
+      if( !err && !c->closed ) {
+         if (start_session( c )) {
+            c->send_handshake ();
+         }
+      } else {
+         if( endpoint_itr != tcp::resolver::iterator() ) {
+            close(c);
+            connect( c, endpoint_itr );
+         }
+         else {
+            elog( "connection failed to ${peer}: ${error}",
+                  ( "peer", c->peer_name())("error",err.message()));
+            c->connecting = false;
+            my_impl->close(c);
+         }
+      }
    }
 
    bool net_plugin_impl::start_session( connection_ptr con ) {
@@ -1982,7 +2117,7 @@ namespace eosio {
 
 
    void net_plugin_impl::start_listen_loop( ) {
-      auto socket = std::make_shared<tcp::socket>( std::ref( app().get_io_service() ) );
+      auto socket = std::make_shared<tcp::socket>( std::ref( *thread_pool_ioc ) );
       acceptor->async_accept( *socket, [socket,this]( boost::system::error_code ec ) {
             if( !ec ) {
                uint32_t visitors = 0;
@@ -1993,11 +2128,10 @@ namespace eosio {
                }
                else {
                   for (auto &conn : connections) {
-                     if(conn->socket->is_open()) {
+                     if(!conn->closed) {
                         if (conn->peer_addr.empty()) {
                            visitors++;
-                           boost::system::error_code ec;
-                           if (paddr == conn->socket->remote_endpoint(ec).address()) {
+                           if (paddr == conn->remote_address) {
                               from_addr++;
                            }
                         }
@@ -2010,6 +2144,7 @@ namespace eosio {
                   if( from_addr < max_nodes_per_host && (max_client_count == 0 || num_clients < max_client_count )) {
                      ++num_clients;
                      connection_ptr c = std::make_shared<connection>( socket );
+                     c->remote_address = paddr;
                      connections.insert( c );
                      start_session( c );
 
@@ -2045,10 +2180,29 @@ namespace eosio {
          });
    }
 
+   void net_plugin_impl::post_close( connection_ptr c ) {
+      app().get_io_service().post( [this, c]() {
+         close( c );
+      });
+   }
+
+   /**
+    * The read loop runs on the connection's strand. Anything that touches connection state other than the
+    * read buffer, including logging the peer name, is posted to the application thread. Reading pauses
+    * while def_max_pending_messages decoded messages of the peer wait for the application thread, so a
+    * flooding peer cannot queue unbounded work; connection::message_handled resumes it.
+    */
    void net_plugin_impl::start_read_message( connection_ptr conn ) {
+      boost::asio::dispatch( conn->strand, [this, conn]() {
+         conn->read_paused = false;
+         read_message( conn );
+      });
+   }
+
+   void net_plugin_impl::read_message( connection_ptr conn ) {
 
       try {
-         if(!conn->socket) {
+         if(!conn->socket || !conn->socket->is_open()) {
             return;
          }
          connection_wptr weak_conn = conn;
@@ -2072,6 +2226,7 @@ namespace eosio {
 
          boost::asio::async_read(*conn->socket,
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
+            boost::asio::bind_executor( conn->strand,
             [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
                auto conn = weak_conn.lock();
                if (!conn) {
@@ -2088,6 +2243,7 @@ namespace eosio {
                      }
                      EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
                      conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
+                     conn->bytes_received.fetch_add(bytes_transferred, std::memory_order_relaxed);
                      while (conn->pending_message_buffer.bytes_to_read() > 0) {
                         uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
 
@@ -2100,7 +2256,7 @@ namespace eosio {
                            conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
                            if(message_length > def_send_buffer_size*2 || message_length == 0) {
                               elog("incoming message length unexpected (${i})", ("i", message_length));
-                              close(conn);
+                              post_close(conn);
                               return;
                            }
 
@@ -2123,37 +2279,40 @@ namespace eosio {
                            }
                         }
                      }
-                     start_read_message(conn);
-                  } else {
-                     auto pname = conn->peer_name();
-                     if (ec.value() != boost::asio::error::eof) {
-                        elog( "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
+                     if (conn->pending_messages.load(std::memory_order_relaxed) >= def_max_pending_messages) {
+                        // the application thread is behind on this peer, message_handled resumes reading
+                        conn->read_paused = true;
                      } else {
-                        ilog( "Peer ${p} closed connection",("p",pname) );
+                        read_message(conn);
                      }
-                     close( conn );
+                  } else {
+                     app().get_io_service().post( [this, conn, ec]() {
+                        auto pname = conn->peer_name();
+                        if (ec.value() != boost::asio::error::eof) {
+                           elog( "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
+                        } else {
+                           ilog( "Peer ${p} closed connection",("p",pname) );
+                        }
+                        close( conn );
+                     });
                   }
                }
                catch(const std::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog("Exception in handling read data from ${p} ${s}",("p",pname)("s",ex.what()));
-                  close( conn );
+                  elog("Exception in handling read data ${s}",("s",ex.what()));
+                  post_close( conn );
                }
                catch(const fc::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog("Exception in handling read data ${s}", ("p",pname)("s",ex.to_string()));
-                  close( conn );
+                  elog("Exception in handling read data ${s}", ("s",ex.to_string()));
+                  post_close( conn );
                }
                catch (...) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog( "Undefined exception hanlding the read data from connection ${p}",( "p",pname));
-                  close( conn );
+                  elog( "Undefined exception hanlding the read data" );
+                  post_close( conn );
                }
-            } );
+            }));
       } catch (...) {
-         string pname = conn ? conn->peer_name() : "no connection name";
-         elog( "Undefined exception handling reading ${p}",("p",pname) );
-         close( conn );
+         elog( "Undefined exception handling reading" );
+         post_close( conn );
       }
    }
 
@@ -2161,7 +2320,7 @@ namespace eosio {
    {
       size_t count = 0;
       for( auto &c : connections) {
-         if(c->socket->is_open())
+         if(!c->closed)
             ++count;
       }
       return count;
@@ -2170,9 +2329,14 @@ namespace eosio {
 
    template<typename VerifierFunc>
    void net_plugin_impl::send_all( const net_message &msg, VerifierFunc verify) {
+      send_all( create_send_buffer( msg ), verify );
+   }
+
+   template<typename VerifierFunc>
+   void net_plugin_impl::send_all( const send_buffer_type& send_buffer, VerifierFunc verify) {
       for( auto &c : connections) {
          if( c->current() && verify( c)) {
-            c->enqueue( msg );
+            c->enqueue_buffer( send_buffer, true, no_reason );
          }
       }
    }
@@ -2604,7 +2768,7 @@ namespace eosio {
                wlog ("Peer keepalive ticked sooner than expected: ${m}", ("m", ec.message()));
             }
             for (auto &c : connections ) {
-               if (c->socket->is_open()) {
+               if (!c->closed) {
                   c->send_time();
                }
             }
@@ -2643,7 +2807,7 @@ namespace eosio {
       start_conn_timer();
       auto it = connections.begin();
       while(it != connections.end()) {
-         if( !(*it)->socket->is_open() && !(*it)->connecting) {
+         if( (*it)->closed && !(*it)->connecting) {
             if( (*it)->peer_addr.length() > 0) {
                connect(*it);
             }
@@ -2657,7 +2821,7 @@ namespace eosio {
    }
 
    void net_plugin_impl::close( connection_ptr c ) {
-      if( c->peer_addr.empty( ) && c->socket->is_open() ) {
+      if( c->peer_addr.empty( ) && !c->closed ) {
          if (num_clients == 0) {
             fc_wlog( logger, "num_clients already at 0");
          }
@@ -2674,7 +2838,7 @@ namespace eosio {
 
    void net_plugin_impl::accepted_block(const block_state_ptr& block) {
       fc_dlog(logger,"signaled, id = ${id}",("id", block->id));
-      dispatcher->bcast_block(*block->block);
+      dispatcher->bcast_block(block->block);
    }
 
    void net_plugin_impl::irreversible_block(const block_state_ptr&block) {
@@ -2860,6 +3024,8 @@ namespace eosio {
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
          ( "max-implicit-request", bpo::value<uint32_t>()->default_value(def_max_just_send), "maximum sizes of transaction or block messages that are sent without first sending a notice")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
+         ( "net-threads", bpo::value<uint16_t>()->default_value(def_thread_pool_size),
+           "Number of worker threads for socket reads, writes and message decoding")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
            "Available Variables:\n"
@@ -2899,6 +3065,12 @@ namespace eosio {
 
          my->use_socket_read_watermark = options.at( "use-socket-read-watermark" ).as<bool>();
 
+         my->thread_pool_size = options.at( "net-threads" ).as<uint16_t>();
+         EOS_ASSERT( my->thread_pool_size > 0, plugin_config_exception,
+                     "net-threads ${num} must be greater than 0", ("num", my->thread_pool_size));
+         my->thread_pool_ioc.reset( new boost::asio::io_context( my->thread_pool_size ) );
+         my->thread_pool_work.emplace( boost::asio::make_work_guard( *my->thread_pool_ioc ) );
+
          my->resolver = std::make_shared<tcp::resolver>( std::ref( app().get_io_service()));
          if( options.count( "p2p-listen-endpoint" )) {
             my->p2p_address = options.at( "p2p-listen-endpoint" ).as<string>();
@@ -2982,6 +3154,11 @@ namespace eosio {
    }
 
    void net_plugin::plugin_startup() {
+      my->thread_pool.reserve( my->thread_pool_size );
+      for( uint16_t i = 0; i < my->thread_pool_size; ++i ) {
+         my->thread_pool.emplace_back( [ioc = my->thread_pool_ioc.get()]() { ioc->run(); } );
+      }
+
       if( my->acceptor ) {
          my->acceptor->open(my->listen_endpoint.protocol());
          my->acceptor->set_option(tcp::acceptor::reuse_address(true));
@@ -3028,6 +3205,15 @@ namespace eosio {
 
             my->acceptor.reset(nullptr);
          }
+
+         if( my->thread_pool_ioc ) {
+            my->thread_pool_work.reset();
+            my->thread_pool_ioc->stop();
+            for( auto& t : my->thread_pool ) {
+               t.join();
+            }
+            my->thread_pool.clear();
+         }
          ilog( "exit shutdown" );
       }
       FC_CAPTURE_AND_RETHROW()
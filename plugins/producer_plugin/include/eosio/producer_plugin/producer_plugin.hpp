@@ -31,6 +31,19 @@ public:
       std::vector<account_name> accounts;
    };
 
+   struct snapshot_information {
+      chain::block_id_type head_block_id;
+      std::string          snapshot_name;
+   };
+
+   /// how often the production loop started a pending block with each outcome
+   struct start_block_metrics {
+      uint64_t succeeded = 0;
+      uint64_t failed    = 0;
+      uint64_t waiting   = 0;
+      uint64_t exhausted = 0;
+   };
+
    producer_plugin();
    virtual ~producer_plugin();
 
@@ -56,6 +69,10 @@ public:
    void remove_greylist_accounts(const greylist_params& params);
    greylist_params get_greylist() const;
 
+   start_block_metrics get_start_block_metrics() const;
+
+   snapshot_information create_snapshot();
+
    signal<void(const chain::producer_confirmation&)> confirmed_block;
 private:
    std::shared_ptr<class producer_plugin_impl> my;
@@ -65,4 +82,6 @@ private:
 
 FC_REFLECT(eosio::producer_plugin::runtime_options, (max_transaction_time)(max_irreversible_block_age)(produce_time_offset_us)(last_block_time_offset_us)(subjective_cpu_leeway_us)(incoming_defer_ratio));
 FC_REFLECT(eosio::producer_plugin::greylist_params, (accounts));
+FC_REFLECT(eosio::producer_plugin::snapshot_information, (head_block_id)(snapshot_name));
+FC_REFLECT(eosio::producer_plugin::start_block_metrics, (succeeded)(failed)(waiting)(exhausted));
 
@@ -7,6 +7,8 @@
 #include <eosio/chain/plugin_interface.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/transaction_object.hpp>
+#include <eosio/chain/generated_transaction_object.hpp>
+#include <eosio/chain/unapplied_transaction_queue.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/smart_ref_impl.hpp>
@@ -16,7 +18,9 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <iostream>
+#include <fstream>
 #include <algorithm>
+#include <map>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/function_output_iterator.hpp>
 #include <boost/multi_index_container.hpp>
@@ -26,6 +30,7 @@
 #include <boost/signals2/connection.hpp>
 
 namespace bmi = boost::multi_index;
+namespace bfs = boost::filesystem;
 using bmi::indexed_by;
 using bmi::ordered_non_unique;
 using bmi::member;
@@ -135,6 +140,10 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       int32_t                                                   _last_block_time_offset_us = 0;
       fc::time_point                                            _irreversible_block_time;
       fc::microseconds                                          _keosd_provider_timeout_us;
+      uint16_t                                                  _thread_pool_size = 2;
+      fc::optional<boost::asio::thread_pool>                    _thread_pool;
+
+      bfs::path                                                 _snapshots_dir;
 
       time_point _last_signed_block_time;
       time_point _start_time = fc::time_point::now();
@@ -331,12 +340,69 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
       }
 
-      std::deque<std::tuple<packed_transaction_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
-
+      std::deque<std::tuple<packed_transaction_ptr, transaction_metadata_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
+
+      /**
+       *  Entry point for transactions arriving from the network or the http api.  Unpacking the transaction,
+       *  computing its ids and recovering the signing keys are context free, so they are done on the
+       *  signature recovery thread pool; only the resulting transaction_metadata is handed back to the
+       *  application thread where the authority check and execution take place.
+       *
+       *  The workers can finish out of order, so every transaction gets a sequence number on arrival and the
+       *  recovered transactions are processed strictly in that order; a transaction depending on an earlier
+       *  one from the same sender is never applied before it.
+       */
       void on_incoming_transaction_async(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+         chain::controller& chain = app().get_plugin<chain_plugin>().chain();
+         auto chain_id = chain.get_chain_id();
+         std::weak_ptr<producer_plugin_impl> weak_this = shared_from_this();
+         const uint64_t seq = _incoming_trx_seq++;
+
+         boost::asio::post( *_thread_pool, [weak_this, seq, chain_id, trx, persist_until_expired, next]() {
+            transaction_metadata_ptr mtrx;
+            fc::exception_ptr except_ptr;
+            auto set_except = [&except_ptr]( const fc::exception_ptr& e ) { except_ptr = e; };
+            try {
+               mtrx = std::make_shared<transaction_metadata>( *trx );
+               mtrx->recover_keys( chain_id );
+            } CATCH_AND_CALL(set_except);
+
+            app().get_io_service().post( [weak_this, seq, trx, mtrx, except_ptr, persist_until_expired, next]() {
+               auto self = weak_this.lock();
+               if( !self ) return;
+               auto* impl = self.get();
+               impl->_recovered_transactions.emplace( seq, [impl, trx, mtrx, except_ptr, persist_until_expired, next]() {
+                  if( except_ptr ) {
+                     next( except_ptr );
+                     impl->_transaction_ack_channel.publish( std::pair<fc::exception_ptr, packed_transaction_ptr>( except_ptr, trx ) );
+                     return;
+                  }
+                  impl->process_incoming_transaction_async( trx, mtrx, persist_until_expired, next );
+               });
+               impl->process_recovered_transactions();
+            });
+         });
+      }
+
+      uint64_t                                   _incoming_trx_seq = 0;        ///< assigned to each incoming transaction on arrival
+      uint64_t                                   _next_recovered_trx_seq = 0;  ///< next sequence number to be processed
+      std::map<uint64_t, std::function<void()>>  _recovered_transactions;      ///< recovered, waiting for earlier arrivals
+
+      void process_recovered_transactions() {
+         auto itr = _recovered_transactions.begin();
+         while( itr != _recovered_transactions.end() && itr->first == _next_recovered_trx_seq ) {
+            auto process = std::move( itr->second );
+            _recovered_transactions.erase( itr );
+            ++_next_recovered_trx_seq;
+            process();
+            itr = _recovered_transactions.begin();
+         }
+      }
+
+      void process_incoming_transaction_async(const packed_transaction_ptr& trx, const transaction_metadata_ptr& mtrx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
          chain::controller& chain = app().get_plugin<chain_plugin>().chain();
          if (!chain.pending_block_state()) {
-            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+            _pending_incoming_transactions.emplace_back(trx, mtrx, persist_until_expired, next);
             return;
          }
 
@@ -351,8 +417,8 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
             }
          };
 
-         auto id = trx->id();
-         if( fc::time_point(trx->expiration()) < block_time ) {
+         const auto& id = mtrx->id;
+         if( fc::time_point(mtrx->trx.expiration) < block_time ) {
             send_response(std::static_pointer_cast<fc::exception>(std::make_shared<expired_tx_exception>(FC_LOG_MESSAGE(error, "expired transaction ${id}", ("id", id)) )));
             return;
          }
@@ -370,10 +436,10 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
 
          try {
-            auto trace = chain.push_transaction(std::make_shared<transaction_metadata>(*trx), deadline);
+            auto trace = chain.push_transaction(mtrx, deadline);
             if (trace->except) {
                if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                  _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+                  _pending_incoming_transactions.emplace_back(trx, mtrx, persist_until_expired, next);
                } else {
                   auto e_ptr = trace->except->dynamic_copy_exception();
                   send_response(e_ptr);
@@ -382,7 +448,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                if (persist_until_expired) {
                   // if this trx didnt fail/soft-fail and the persist flag is set, store its ID so that we can
                   // ensure its applied to all future speculative blocks as well.
-                  _persistent_transactions.insert(transaction_id_with_expiry{trx->id(), trx->expiration()});
+                  _persistent_transactions.insert(transaction_id_with_expiry{mtrx->id, mtrx->trx.expiration});
                }
                send_response(trace);
             }
@@ -416,6 +482,8 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       };
 
       start_block_result start_block(bool &last_block);
+
+      producer_plugin::start_block_metrics _start_block_metrics; ///< only touched on the application thread
 };
 
 void new_chain_banner(const eosio::chain::controller& db)
@@ -485,6 +553,10 @@ void producer_plugin::set_program_options(
           "offset of last block producing time in micro second. Negative number results in blocks to go out sooner, and positive number results in blocks to go out later")
          ("incoming-defer-ratio", bpo::value<double>()->default_value(1.0),
           "ratio between incoming transations and deferred transactions when both are exhausted")
+         ("producer-threads", bpo::value<uint16_t>()->default_value(2),
+          "Number of worker threads used to unpack incoming transactions and recover their signing keys")
+         ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
+          "the location of the snapshots directory (absolute path or relative to application data dir)")
          ;
    config_file_options.add(producer_options);
 }
@@ -607,6 +679,26 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
 
+   my->_thread_pool_size = options.at("producer-threads").as<uint16_t>();
+   EOS_ASSERT( my->_thread_pool_size > 0, plugin_config_exception,
+               "producer-threads ${num} must be greater than 0", ("num", my->_thread_pool_size) );
+   my->_thread_pool.emplace( my->_thread_pool_size );
+
+   if( options.count( "snapshots-dir" )) {
+      auto sd = options.at( "snapshots-dir" ).as<bfs::path>();
+      if( sd.is_relative()) {
+         my->_snapshots_dir = app().data_dir() / sd;
+         if (!fc::exists(my->_snapshots_dir)) {
+            fc::create_directories(my->_snapshots_dir);
+         }
+      } else {
+         my->_snapshots_dir = sd;
+      }
+
+      EOS_ASSERT( fc::is_directory(my->_snapshots_dir), snapshot_directory_not_found_exception,
+                  "No such directory '${dir}'", ("dir", my->_snapshots_dir.generic_string()) );
+   }
+
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe([this](const signed_block_ptr& block){
       try {
          my->on_incoming_block(block);
@@ -684,6 +776,11 @@ void producer_plugin::plugin_shutdown() {
       edump((e.to_detail_string()));
    }
 
+   if( my->_thread_pool ) {
+      my->_thread_pool->stop();
+      my->_thread_pool->join();
+   }
+
    my->_accepted_block_connection.reset();
    my->_irreversible_block_connection.reset();
 }
@@ -767,6 +864,37 @@ void producer_plugin::remove_greylist_accounts(const greylist_params& params) {
    }
 }
 
+producer_plugin::snapshot_information producer_plugin::create_snapshot() {
+   chain::controller& chain = app().get_plugin<chain_plugin>().chain();
+
+   // the pending block is not part of the chain state yet, the snapshot is taken at the head block
+   chain.abort_block();
+   auto reschedule = fc::make_scoped_exit([this](){
+      my->schedule_production_loop();
+   });
+
+   auto head_id = chain.head_block_id();
+   std::string snapshot_path = (my->_snapshots_dir / fc::format_string("snapshot-${id}.bin", fc::mutable_variant_object()("id", head_id))).generic_string();
+
+   EOS_ASSERT( !fc::is_regular_file(snapshot_path), snapshot_exists_exception,
+               "snapshot named ${name} already exists", ("name", snapshot_path) );
+
+   // write to a temporary name so that a partially written snapshot is never mistaken for a complete one
+   std::string temp_path = snapshot_path + ".incomplete";
+   {
+      std::ofstream snapshot_stream( temp_path, std::ios::out | std::ios::binary );
+      chain.write_snapshot( std::make_shared<snapshot_writer>( snapshot_stream ) );
+      EOS_ASSERT( snapshot_stream.good(), snapshot_exception, "failed to write snapshot ${name}", ("name", temp_path) );
+   }
+   fc::rename( temp_path, snapshot_path );
+
+   return {head_id, snapshot_path};
+}
+
+producer_plugin::start_block_metrics producer_plugin::get_start_block_metrics() const {
+   return my->_start_block_metrics;
+}
+
 producer_plugin::greylist_params producer_plugin::get_greylist() const {
    chain::controller& chain = app().get_plugin<chain_plugin>().chain();
    greylist_params result;
@@ -927,7 +1055,10 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
 
       // attempt to play persisted transactions first
       bool exhausted = false;
-      auto unapplied_trxs = chain.get_unapplied_transactions();
+      const auto& unapplied_trxs = chain.get_unapplied_transaction_queue();
+
+      // unapplied transactions that expire before this block can never be included, drop them up front
+      chain.drop_expired_unapplied_transactions(pbs->header.timestamp.to_time_point());
 
       // remove all persisted transactions that have now expired
       auto& persisted_by_id = _persistent_transactions.get<by_id>();
@@ -937,8 +1068,14 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
       }
 
       try {
-         for (auto itr = unapplied_trxs.begin(); itr != unapplied_trxs.end(); ++itr) {
-            const auto& trx = *itr;
+         // the queue is walked with a cursor as applied transactions leave it while we iterate
+         uint64_t cursor = 0;
+         while (!persisted_by_id.empty()) {
+            auto trx = unapplied_trxs.next(cursor);
+            if (!trx) {
+               break;
+            }
+
             if (persisted_by_id.find(trx->id) != persisted_by_id.end()) {
                // this is a persisted transaction, push it into the block (even if we are speculating) with
                // no deadline as it has already passed the subjective deadlines once and we want to represent
@@ -949,29 +1086,21 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                   app().get_plugin<chain_plugin>().handle_guard_exception(e);
                   return start_block_result::failed;
                } FC_LOG_AND_DROP();
-
-               // remove it from further consideration as it is applied
-               *itr = nullptr;
             }
          }
 
          size_t orig_pending_txn_size = _pending_incoming_transactions.size();
 
          if (_pending_block_mode == pending_block_mode::producing) {
-            for (const auto& trx : unapplied_trxs) {
+            cursor = 0;
+            while (auto trx = unapplied_trxs.next(cursor)) {
                if (block_time <= fc::time_point::now()) exhausted = true;
                if (exhausted) {
                   break;
                }
 
-               if (!trx) {
-                  // nulled in the loop above, skip it
-                  continue;
-               }
-
-               if (trx->packed_trx.expiration() < pbs->header.timestamp.to_time_point()) {
-                  // expired, drop it
-                  chain.drop_unapplied_transaction(trx);
+               if (persisted_by_id.find(trx->id) != persisted_by_id.end()) {
+                  // already attempted in the loop above
                   continue;
                }
 
@@ -1005,9 +1134,10 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                blacklist_by_expiry.erase(blacklist_by_expiry.begin());
             }
 
-            auto scheduled_trxs = chain.get_scheduled_transactions();
-
-            for (const auto& trx : scheduled_trxs) {
+            // resume from the last scheduled transaction handed out rather than collecting every ready id up front,
+            // the object returned by next_scheduled_transaction is used before anything else touches the state
+            scheduled_transaction_cursor scheduled_cursor;
+            while (true) {
                if (block_time <= fc::time_point::now()) exhausted = true;
                if (exhausted) {
                   break;
@@ -1019,7 +1149,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                   _pending_incoming_transactions.pop_front();
                   --orig_pending_txn_size;
                   _incoming_trx_weight -= 1.0;
-                  on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+                  process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e), std::get<3>(e));
                }
 
                if (block_time <= fc::time_point::now()) {
@@ -1027,10 +1157,17 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                   break;
                }
 
-               if (blacklist_by_id.find(trx) != blacklist_by_id.end()) {
+               const auto* gto = chain.next_scheduled_transaction(scheduled_cursor);
+               if (!gto) {
+                  break;
+               }
+
+               if (blacklist_by_id.find(gto->trx_id) != blacklist_by_id.end()) {
                   continue;
                }
 
+               const auto trx = gto->trx_id;
+
                try {
                   auto deadline = fc::time_point::now() + fc::milliseconds(_max_transaction_time_ms);
                   bool deadline_is_subjective = false;
@@ -1039,7 +1176,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                      deadline = block_time;
                   }
 
-                  auto trace = chain.push_scheduled_transaction(trx, deadline);
+                  auto trace = chain.push_scheduled_transaction(*gto, deadline);
                   if (trace->except) {
                      if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
                         exhausted = true;
@@ -1068,7 +1205,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                auto e = _pending_incoming_transactions.front();
                _pending_incoming_transactions.pop_front();
                --orig_pending_txn_size;
-               on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+               process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e), std::get<3>(e));
                if (block_time <= fc::time_point::now()) return start_block_result::exhausted;
             }
             return start_block_result::succeeded;
@@ -1091,6 +1228,12 @@ void producer_plugin_impl::schedule_production_loop() {
 
    bool last_block;
    auto result = start_block(last_block);
+   switch (result) {
+      case start_block_result::succeeded: ++_start_block_metrics.succeeded; break;
+      case start_block_result::failed:    ++_start_block_metrics.failed;    break;
+      case start_block_result::waiting:   ++_start_block_metrics.waiting;   break;
+      case start_block_result::exhausted: ++_start_block_metrics.exhausted; break;
+   }
 
    if (result == start_block_result::failed) {
       elog("Failed to start a pending block, will try again later");
@@ -0,0 +1,231 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Replays a range of an existing blocks.log into a scratch state and reports the throughput, the time spent per
+ *  contract action, WASM compile time and chain state growth as JSON, so that builds can be compared.
+ */
+#include <eosio/chain/controller.hpp>
+#include <eosio/chain/block_log.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+
+namespace {
+   struct action_stats {
+      uint64_t count = 0;
+      int64_t  elapsed_us = 0;
+   };
+
+   struct replay_stats {
+      bool                                      measuring = false;
+      uint64_t                                  transactions = 0;
+      uint64_t                                  actions = 0;
+      map<pair<account_name,action_name>, action_stats> by_action;
+
+      void add( const action_trace& at ) {
+         ++actions;
+         auto& s = by_action[std::make_pair( at.act.account, at.act.name )];
+         ++s.count;
+         s.elapsed_us += at.elapsed.count();
+         for( const auto& inline_trace : at.inline_traces )
+            add( inline_trace );
+      }
+   };
+
+   uint64_t used_state_bytes( const controller& chain ) {
+      const auto* segment = chain.db().get_segment_manager();
+      return segment->get_size() - segment->get_free_memory();
+   }
+}
+
+int main( int argc, char** argv ) {
+   try {
+      bpo::options_description opts( "eosio-replay-bench options" );
+      opts.add_options()
+         ("help,h", "print this help message and exit")
+         ("blocks-dir", bpo::value<bfs::path>()->required(), "directory of the blocks.log to replay")
+         ("data-dir", bpo::value<bfs::path>(), "scratch directory for the replayed state, a temporary directory if not given")
+         ("snapshot", bpo::value<bfs::path>(), "start from this snapshot instead of the genesis state of the blocks.log")
+         ("start-block", bpo::value<uint32_t>()->default_value(0),
+          "first block measured, the blocks before it are applied without being measured (default: the first block after the initial state)")
+         ("end-block", bpo::value<uint32_t>()->default_value(0), "last block replayed (default: the last block in the blocks.log)")
+         ("state-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024 * 1024)),
+          "maximum size (in MiB) of the scratch chain state database")
+         ("wasm-runtime", bpo::value<wasm_interface::vm_type>()->value_name("wavm/binaryen"), "override the default WASM runtime")
+         ("top-actions", bpo::value<uint32_t>()->default_value(50), "number of contract actions reported, by time spent")
+         ("output", bpo::value<bfs::path>(), "write the JSON report to this file instead of stdout")
+         ;
+
+      bpo::variables_map vm;
+      bpo::store( bpo::parse_command_line( argc, argv, opts ), vm );
+      if( vm.count( "help" ) ) {
+         std::cout << opts << std::endl;
+         return 0;
+      }
+      bpo::notify( vm );
+
+      fc::path blocks_dir = vm.at( "blocks-dir" ).as<bfs::path>();
+      block_log source( blocks_dir );
+      auto source_head = source.read_head();
+      EOS_ASSERT( source_head, block_log_exception, "no blocks in ${d}", ("d", blocks_dir.generic_string()) );
+
+      fc::temp_directory scratch;
+      fc::path data_dir = vm.count( "data-dir" ) ? fc::path( vm.at( "data-dir" ).as<bfs::path>() ) : scratch.path();
+      EOS_ASSERT( !fc::exists( data_dir / config::default_state_dir_name ), chain_exception,
+                  "${d} already contains a state directory, the replay needs an empty scratch directory",
+                  ("d", data_dir.generic_string()) );
+
+      controller::config cfg;
+      cfg.blocks_dir = data_dir / config::default_blocks_dir_name;
+      cfg.state_dir  = data_dir / config::default_state_dir_name;
+      cfg.state_size = vm.at( "state-size-mb" ).as<uint64_t>() * 1024 * 1024;
+      cfg.genesis    = block_log::extract_genesis_state( blocks_dir );
+      if( vm.count( "wasm-runtime" ) )
+         cfg.wasm_runtime = vm.at( "wasm-runtime" ).as<wasm_interface::vm_type>();
+
+      controller chain( cfg );
+      if( vm.count( "snapshot" ) ) {
+         std::ifstream snapshot_stream( vm.at( "snapshot" ).as<bfs::path>().generic_string(), std::ios::in | std::ios::binary );
+         chain.startup( std::make_shared<snapshot_reader>( snapshot_stream ) );
+      } else {
+         chain.startup();
+      }
+
+      uint32_t first_block = chain.head_block_num() + 1;
+      uint32_t start_block = std::max( vm.at( "start-block" ).as<uint32_t>(), first_block );
+      uint32_t end_block   = vm.at( "end-block" ).as<uint32_t>();
+      if( end_block == 0 )
+         end_block = source_head->block_num();
+      EOS_ASSERT( first_block >= source.first_block_num(), block_log_exception,
+                  "the blocks.log starts at block ${f}, after the initial state at block ${h}",
+                  ("f", source.first_block_num())("h", first_block - 1) );
+      EOS_ASSERT( start_block <= end_block && end_block <= source_head->block_num(), chain_exception,
+                  "invalid block range ${s} - ${e}, the blocks.log ends at ${h}",
+                  ("s", start_block)("e", end_block)("h", source_head->block_num()) );
+
+      replay_stats stats;
+      auto applied_connection = chain.applied_transaction.connect( [&]( const transaction_trace_ptr& t ) {
+         if( !stats.measuring ) return;
+         for( const auto& at : t->action_traces )
+            stats.add( at );
+      } );
+
+      for( uint32_t n = first_block; n < start_block; ++n ) {
+         auto b = source.read_block_by_num( n );
+         EOS_ASSERT( b, block_log_exception, "block ${n} is missing from the blocks.log", ("n", n) );
+         chain.push_block( b, controller::block_status::irreversible );
+      }
+
+      auto stages_before = chain.get_block_timings();
+      auto wasm_before = chain.get_wasm_interface().get_cache_stats();
+      auto state_before = used_state_bytes( chain );
+      stats.measuring = true;
+
+      auto start = fc::time_point::now();
+      for( uint32_t n = start_block; n <= end_block; ++n ) {
+         auto b = source.read_block_by_num( n );
+         EOS_ASSERT( b, block_log_exception, "block ${n} is missing from the blocks.log", ("n", n) );
+         stats.transactions += b->transactions.size();
+         chain.push_block( b, controller::block_status::irreversible );
+      }
+      auto elapsed = fc::time_point::now() - start;
+
+      stats.measuring = false;
+      applied_connection.disconnect();
+      auto wasm_after = chain.get_wasm_interface().get_cache_stats();
+      auto state_after = used_state_bytes( chain );
+      auto stages_after = chain.get_block_timings();
+
+      // from the totals since startup, the controller's rolling windows also hold warm-up blocks and only the
+      // last samples of a long range
+      fc::variants stage_report;
+      for( size_t i = 0; i < stages_after.size() && i < stages_before.size(); ++i ) {
+         const uint64_t count = stages_after[i].count - stages_before[i].count;
+         const int64_t total_us = stages_after[i].total_us - stages_before[i].total_us;
+         stage_report.emplace_back( fc::mutable_variant_object()
+            ("stage", stages_after[i].stage)
+            ("count", count)
+            ("total_us", total_us)
+            ("avg_us", count ? total_us / int64_t(count) : 0) );
+      }
+
+      vector<pair<pair<account_name,action_name>, action_stats>> actions( stats.by_action.begin(), stats.by_action.end() );
+      std::sort( actions.begin(), actions.end(), []( const auto& a, const auto& b ) {
+         return a.second.elapsed_us > b.second.elapsed_us;
+      } );
+      actions.resize( std::min<size_t>( actions.size(), vm.at( "top-actions" ).as<uint32_t>() ) );
+      fc::variants action_report;
+      for( const auto& a : actions ) {
+         action_report.emplace_back( fc::mutable_variant_object()
+            ("account", a.first.first)
+            ("action", a.first.second)
+            ("count", a.second.count)
+            ("elapsed_us", a.second.elapsed_us)
+            ("avg_us", a.second.count ? a.second.elapsed_us / int64_t(a.second.count) : 0) );
+      }
+
+      const uint32_t blocks = end_block - start_block + 1;
+      const double seconds = std::max<double>( elapsed.count(), 1 ) / 1e6;
+      auto report = fc::mutable_variant_object()
+         ("start_block", start_block)
+         ("end_block", end_block)
+         ("blocks", blocks)
+         ("transactions", stats.transactions)
+         ("actions", stats.actions)
+         ("elapsed_us", elapsed.count())
+         ("blocks_per_second", blocks / seconds)
+         ("transactions_per_second", stats.transactions / seconds)
+         ("actions_per_second", stats.actions / seconds)
+         ("wasm", fc::mutable_variant_object()
+            ("compiles", wasm_after.compiles - wasm_before.compiles)
+            ("cache_misses", wasm_after.misses - wasm_before.misses)
+            ("compile_time_us", wasm_after.compile_time - wasm_before.compile_time)
+            ("cache_hits", wasm_after.hits - wasm_before.hits))
+         ("state", fc::mutable_variant_object()
+            ("used_bytes_before", state_before)
+            ("used_bytes_after", state_after)
+            ("growth_bytes", int64_t(state_after) - int64_t(state_before)))
+         ("stages", stage_report)
+         ("top_actions", action_report);
+
+      auto json = fc::json::to_pretty_string( fc::variant( report ) );
+      if( vm.count( "output" ) ) {
+         std::ofstream out( vm.at( "output" ).as<bfs::path>().generic_string() );
+         out << json << std::endl;
+      } else {
+         std::cout << json << std::endl;
+      }
+   } catch( const bpo::error& e ) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()) );
+      return 1;
+   } catch( const boost::exception& e ) {
+      elog( "${e}", ("e", boost::diagnostic_information(e)) );
+      return 1;
+   } catch( const std::exception& e ) {
+      elog( "${e}", ("e", e.what()) );
+      return 1;
+   }
+   return 0;
+}
@@ -43,6 +43,10 @@ fc::variant verify_byte_round_trip_conversion( const abi_serializer& abis, const
 
    std::string r = fc::json::to_string(var2);
 
+   std::string json;
+   abis.binary_to_json(type, bytes, json, max_serialization_time);
+   BOOST_TEST( json == r );
+
    auto bytes2 = abis.variant_to_binary(type, var2, max_serialization_time);
 
    BOOST_TEST( fc::to_hex(bytes) == fc::to_hex(bytes2) );
@@ -3132,6 +3136,56 @@ BOOST_AUTO_TEST_CASE(abi_type_def)
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE(abi_shadowed_base_field)
+{ try {
+   // a derived struct repeating a field of its base, binary_to_json has to print it once like the variant does
+   const char* shadow_abi = R"=====(
+   {
+     "types": [],
+     "structs": [{
+         "name": "base",
+         "base": "",
+         "fields": [{
+            "name": "owner",
+            "type": "name"
+         },{
+            "name": "amount",
+            "type": "uint64"
+         }]
+       },{
+         "name": "derived",
+         "base": "base",
+         "fields": [{
+            "name": "amount",
+            "type": "uint64"
+         },{
+            "name": "memo",
+            "type": "string"
+         }]
+       },{
+         "name": "holder",
+         "base": "",
+         "fields": [{
+            "name": "items",
+            "type": "derived[]"
+         }]
+       }
+     ],
+     "actions": [],
+     "tables": []
+   }
+   )=====";
+
+   abi_serializer abis(fc::json::from_string(shadow_abi).as<abi_def>(), max_serialization_time);
+
+   auto var = fc::json::from_string(R"=====({"owner":"kevin","amount":16,"memo":"hi"})=====");
+   auto var2 = verify_byte_round_trip_conversion(abis, "derived", var);
+   BOOST_CHECK_EQUAL(3u, var2.get_object().size());
+
+   verify_byte_round_trip_conversion(abis, "holder", fc::json::from_string(R"=====({"items":[{"owner":"dan","amount":1,"memo":""}]})====="));
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(abi_type_loop)
 { try {
    // inifinite loop in types
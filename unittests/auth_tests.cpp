@@ -92,6 +92,32 @@ BOOST_FIXTURE_TEST_CASE( delegate_auth, TESTER ) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( cached_authorization_follows_updateauth ) { try {
+   TESTER chain;
+   chain.create_account(N(alice));
+   chain.produce_block();
+
+   const vector<permission_level> alice_active{ {N(alice), config::active_name} };
+   const auto old_active_priv_key = chain.get_private_key(N(alice), "active");
+   const auto new_active_priv_key = chain.get_private_key(N(alice), "new_active");
+
+   // the result for alice@active and her key is cached by the first check
+   chain.push_reqauth(N(alice), alice_active, { old_active_priv_key });
+   chain.produce_block();
+
+   chain.set_authority(N(alice), config::active_name, authority(new_active_priv_key.get_public_key()), config::owner_name,
+                       alice_active, { old_active_priv_key });
+
+   // in the block that changed it, and in the following ones, only the new key satisfies alice@active
+   BOOST_CHECK_THROW(chain.push_reqauth(N(alice), alice_active, { old_active_priv_key }), unsatisfied_authorization);
+   chain.push_reqauth(N(alice), alice_active, { new_active_priv_key });
+   chain.produce_block();
+
+   BOOST_CHECK_THROW(chain.push_reqauth(N(alice), alice_active, { old_active_priv_key }), unsatisfied_authorization);
+   chain.push_reqauth(N(alice), alice_active, { new_active_priv_key });
+   chain.produce_block();
+} FC_LOG_AND_RETHROW() }
+
 
 BOOST_AUTO_TEST_CASE(update_auths) {
 try {
@@ -0,0 +1,156 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <eosio/chain/config.hpp>
+#include <eosio/chain/wasm_interface_private.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+
+using namespace eosio::chain;
+
+namespace {
+   wasm_interface::vm_type test_runtime() {
+      auto runtime = config::default_wasm_runtime;
+      for( int i = 0; i < boost::unit_test::framework::master_test_suite().argc; ++i ) {
+         if( boost::unit_test::framework::master_test_suite().argv[i] == std::string("--binaryen") )
+            runtime = wasm_interface::vm_type::binaryen;
+         else if( boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wavm") )
+            runtime = wasm_interface::vm_type::wavm;
+      }
+      return runtime;
+   }
+
+   wasm_interface::vm_type other_runtime() {
+      return test_runtime() == wasm_interface::vm_type::wavm ? wasm_interface::vm_type::binaryen : wasm_interface::vm_type::wavm;
+   }
+
+   /// a contract of its own for every n
+   std::vector<char> contract( int n ) {
+      auto wasm = wast_to_wasm( "(module (export \"apply\" (func $apply))"
+                                " (func $apply (param $0 i64) (param $1 i64) (param $2 i64)"
+                                " (drop (i64.add (get_local $0) (i64.const " + std::to_string(n) + ")))))" );
+      return std::vector<char>( wasm.begin(), wasm.end() );
+   }
+
+   /// compiles contracts first .. first + count - 1, which writes them to the code cache in dir
+   std::vector<digest_type> store( const fc::path& dir, int first, int count ) {
+      wasm_interface_impl impl( test_runtime(), dir, wasm_interface::cache_limits() );
+      std::vector<digest_type> ids;
+      for( int n = first; n < first + count; ++n ) {
+         auto code = contract( n );
+         ids.push_back( fc::sha256::hash( code.data(), code.size() ) );
+         impl.compile( ids.back(), code.data(), code.size() );
+         BOOST_REQUIRE( fc::exists( impl.code_cache_file( ids.back() ) ) );
+      }
+      return ids;
+   }
+
+   /// the entries a starting wasm interface takes from the code cache in dir, once they are instantiated
+   std::set<digest_type> load( const fc::path& dir, wasm_interface::vm_type runtime, const wasm_interface::cache_limits& limits ) {
+      wasm_interface_impl impl( runtime, dir, limits );
+      std::set<digest_type> ids;
+      for( auto& pending : impl.compiling ) {
+         BOOST_REQUIRE( pending.second.module.get() );
+         ids.insert( pending.first );
+      }
+      return ids;
+   }
+
+   fc::path cache_file( const fc::path& dir, const digest_type& code_id ) {
+      return dir / (code_id.str() + ".bin");
+   }
+
+   void overwrite( const fc::path& file, std::streamoff pos, const std::string& bytes ) {
+      std::fstream f( file.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekp( pos );
+      f.write( bytes.data(), bytes.size() );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(code_cache_tests)
+
+BOOST_AUTO_TEST_CASE( code_cache_round_trip ) try {
+   fc::temp_directory tempdir;
+   const auto ids = store( tempdir.path(), 0, 2 );
+
+   BOOST_CHECK( load( tempdir.path(), test_runtime(), wasm_interface::cache_limits() ) == std::set<digest_type>( ids.begin(), ids.end() ) );
+   // loading leaves the entries in place for the next start
+   for( const auto& id : ids )
+      BOOST_CHECK( fc::exists( cache_file( tempdir.path(), id ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( code_cache_rejects_entries ) try {
+   fc::temp_directory tempdir;
+   const auto ids = store( tempdir.path(), 0, 3 );
+
+   // the last byte of the code, the one after it is the empty initial memory; the entry still deserializes
+   const auto damaged = cache_file( tempdir.path(), ids[0] );
+   overwrite( damaged, fc::file_size( damaged ) - 2, std::string( 1, '\xfe' ) );
+   // the version follows the magic number
+   const uint32_t other_version = cached_code::current_version + 1;
+   overwrite( cache_file( tempdir.path(), ids[1] ), sizeof(uint32_t), std::string( (const char*)&other_version, sizeof(other_version) ) );
+
+   BOOST_CHECK( load( tempdir.path(), test_runtime(), wasm_interface::cache_limits() ) == std::set<digest_type>{ ids[2] } );
+   BOOST_CHECK( !fc::exists( cache_file( tempdir.path(), ids[0] ) ) );
+   BOOST_CHECK( !fc::exists( cache_file( tempdir.path(), ids[1] ) ) );
+
+   // written by the other runtime
+   BOOST_CHECK( load( tempdir.path(), other_runtime(), wasm_interface::cache_limits() ).empty() );
+   BOOST_CHECK( !fc::exists( cache_file( tempdir.path(), ids[2] ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( code_cache_pruning ) try {
+   fc::temp_directory tempdir;
+   const auto ids = store( tempdir.path(), 0, 3 );
+
+   // ids[2] most recently used
+   const auto now = std::time( nullptr );
+   for( size_t i = 0; i < ids.size(); ++i )
+      boost::filesystem::last_write_time( cache_file( tempdir.path(), ids[i] ).generic_string(), now - 300 + 100 * std::time_t(i) );
+
+   wasm_interface::cache_limits by_count;
+   by_count.max_entries = 2;
+   BOOST_CHECK( load( tempdir.path(), test_runtime(), by_count ) == (std::set<digest_type>{ ids[1], ids[2] }) );
+   BOOST_CHECK( !fc::exists( cache_file( tempdir.path(), ids[0] ) ) );
+
+   // the first entry alone reaches the limit
+   wasm_interface::cache_limits by_size;
+   by_size.max_code_size = 1;
+   BOOST_CHECK( load( tempdir.path(), test_runtime(), by_size ) == std::set<digest_type>{ ids[2] } );
+   BOOST_CHECK( !fc::exists( cache_file( tempdir.path(), ids[1] ) ) );
+   BOOST_CHECK( fc::exists( cache_file( tempdir.path(), ids[2] ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( pending_compile_limit ) try {
+   wasm_interface_impl impl( test_runtime(), fc::path(), wasm_interface::cache_limits() );
+   const size_t limit = wasm_interface_impl::max_pending_compiles;
+   const auto code = contract( 0 );
+   {
+      // the compile thread cannot finish anything while this is held, so every compile stays pending
+      std::lock_guard<std::mutex> g( impl.compile_mutex );
+      for( size_t i = 0; i < limit + 8; ++i )
+         impl.compile_async( fc::sha256::hash( std::to_string(i) ), code );
+      BOOST_CHECK_EQUAL( impl.compiling.size(), limit );
+      BOOST_CHECK( !impl.compiling.count( fc::sha256::hash( std::to_string(limit) ) ) );
+   }
+
+   for( auto& pending : impl.compiling )
+      pending.second.module.wait();
+   // the finished compiles move into the instantiation cache, which leaves room for the next one
+   impl.compile_async( fc::sha256::hash( std::to_string(limit) ), code );
+   BOOST_CHECK_EQUAL( impl.instantiation_cache.size(), limit );
+   BOOST_CHECK_EQUAL( impl.compiling.size(), 1u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -633,3 +633,31 @@ static const char memory_growth_memset_test[] = R"=====(
  )
 )
 )=====";
+
+// an initial memory image of more than 64KiB, reaching into the second page; prints the image's last word
+// (4294967295) and writes past the image
+static const char memory_image_large[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "printi" (func $printi (param i64)))
+ (memory $0 2)
+ (data (i32.const 65536) "\ff\ff\ff\ff")
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+   (call $printi (i64.load32_u offset=65536 (i32.const 0)))
+   (i32.store offset=65540 (i32.const 0) (i32.const -1))
+ )
+)
+)=====";
+
+// grows into the second page and prints its first 8 bytes, which have to be 0 whatever ran before
+static const char memory_image_small[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "printi" (func $printi (param i64)))
+ (memory $0 1)
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+   (drop (grow_memory (i32.const 1)))
+   (call $printi (i64.load offset=65536 (i32.const 0)))
+ )
+)
+)=====";
@@ -6,6 +6,9 @@
 #include <eosio/chain/authority_checker.hpp>
 #include <eosio/chain/authority.hpp>
 #include <eosio/chain/types.hpp>
+#include <eosio/chain/unapplied_transaction_queue.hpp>
+#include <eosio/chain/block_timing.hpp>
+#include <eosio/chain/merkle.hpp>
 #include <eosio/chain/asset.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -643,6 +646,93 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    bytes raw2 = pkt2.get_raw_transaction();
    BOOST_CHECK_EQUAL(raw.size(), raw2.size());
 
+   // copies share the decoded transaction, setting a new one drops it
+   packed_transaction pkt3 = pkt;
+   BOOST_CHECK_EQUAL(trx.id(), pkt3.id());
+   trx.expiration = trx.expiration + 1;
+   pkt3.set_transaction(trx, packed_transaction::none);
+   BOOST_CHECK_EQUAL(trx.id(), pkt3.id());
+   BOOST_CHECK(pkt.id() != pkt3.id());
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(unapplied_transaction_queue_test) { try {
+   auto make_trx = []( account_name payer, uint32_t expiration ) {
+      signed_transaction trx;
+      trx.expiration = fc::time_point_sec( expiration );
+      trx.actions.emplace_back( vector<permission_level>{{payer, config::active_name}}, N(eosio), N(reqauth), bytes() );
+      return std::make_shared<transaction_metadata>( trx );
+   };
+
+   unapplied_transaction_queue queue;
+   auto t1 = make_trx( N(alice), 30 );
+   auto t2 = make_trx( N(bob), 10 );
+   auto t3 = make_trx( N(alice), 20 );
+   queue.add( t1 );
+   queue.add( t2 );
+   queue.add( t3 );
+   queue.add( t1 );
+   BOOST_REQUIRE_EQUAL( 3, queue.size() );
+   BOOST_REQUIRE_EQUAL( 2, queue.count_by_payer( N(alice) ) );
+
+   // arrival order, and erasing the returned transaction does not disturb the walk
+   uint64_t cursor = 0;
+   BOOST_REQUIRE( queue.next( cursor ) == t1 );
+   BOOST_REQUIRE( queue.erase( t1->signed_id ) );
+   BOOST_REQUIRE( queue.next( cursor ) == t2 );
+   BOOST_REQUIRE( queue.next( cursor ) == t3 );
+   BOOST_REQUIRE( !queue.next( cursor ) );
+
+   BOOST_REQUIRE_EQUAL( 1, queue.erase_expired( fc::time_point_sec( 15 ) ) );
+   BOOST_REQUIRE( !queue.contains( t2->signed_id ) );
+   BOOST_REQUIRE( queue.contains( t3->signed_id ) );
+   BOOST_REQUIRE_EQUAL( 1, queue.size() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(block_timing_test) { try {
+   block_timing timing( 100 );
+   for( int64_t us = 1; us <= 200; ++us )
+      timing.record( block_stage::push_transaction, fc::microseconds( us ) );
+   timing.record( block_stage::sign_block, fc::microseconds( 5 ) );
+
+   auto stages = timing.get_timings();
+   const auto& t = stages[static_cast<size_t>(block_stage::push_transaction)];
+   BOOST_REQUIRE_EQUAL( "push_transaction", t.stage );
+   BOOST_REQUIRE_EQUAL( 200, t.count );
+   // the total covers every sample, the statistics below only the last 100
+   BOOST_REQUIRE_EQUAL( 20100, t.total_us );
+   BOOST_REQUIRE_EQUAL( 100, t.window_count );
+   BOOST_REQUIRE_EQUAL( 101, t.min_us );
+   BOOST_REQUIRE_EQUAL( 200, t.max_us );
+   BOOST_REQUIRE_EQUAL( 150, t.p50_us );
+   BOOST_REQUIRE_EQUAL( 100, t.buckets[8] + t.buckets[7] );
+
+   BOOST_REQUIRE_EQUAL( "push_transaction 200x 20100us, sign_block 5us", timing.block_summary() );
+   timing.reset_block();
+   BOOST_REQUIRE_EQUAL( "", timing.block_summary() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(merkle_test) { try {
+   // straightforward merkle over copied levels, as it was computed before hashing in place
+   auto reference_merkle = []( vector<digest_type> ids ) {
+      while( ids.size() > 1 ) {
+         if( ids.size() % 2 )
+            ids.push_back( ids.back() );
+         vector<digest_type> parents;
+         for( size_t i = 0; i < ids.size(); i += 2 )
+            parents.emplace_back( digest_type::hash( make_canonical_pair( ids[i], ids[i + 1] ) ) );
+         ids = move( parents );
+      }
+      return ids.front();
+   };
+
+   BOOST_REQUIRE( merkle( vector<digest_type>() ) == digest_type() );
+
+   vector<digest_type> ids;
+   for( uint32_t n = 1; n <= 33; ++n ) {
+      ids.emplace_back( digest_type::hash( n ) );
+      BOOST_REQUIRE_EQUAL( reference_merkle( ids ).str(), merkle( ids ).str() );
+   }
 } FC_LOG_AND_RETHROW() }
 
 BOOST_AUTO_TEST_SUITE_END()
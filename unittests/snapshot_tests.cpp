@@ -0,0 +1,105 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <boost/test/unit_test.hpp>
+#include <eosio/testing/tester.hpp>
+#include <eosio/chain/snapshot.hpp>
+
+#include <eosio.token/eosio.token.wast.hpp>
+#include <eosio.token/eosio.token.abi.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include <sstream>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace fc;
+
+using mvo = fc::mutable_variant_object;
+
+namespace {
+   controller::config snapshot_config( const tester& chain, const fc::temp_directory& tempdir ) {
+      auto cfg = chain.get_config();
+      cfg.blocks_dir = tempdir.path() / config::default_blocks_dir_name;
+      cfg.state_dir  = tempdir.path() / config::default_state_dir_name;
+      return cfg;
+   }
+
+   std::shared_ptr<snapshot_reader> take_snapshot( tester& chain, std::stringstream& snapshot_stream ) {
+      chain.control->abort_block();
+      chain.control->write_snapshot( std::make_shared<snapshot_writer>( snapshot_stream ) );
+      return std::make_shared<snapshot_reader>( snapshot_stream );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(snapshot_tests)
+
+BOOST_AUTO_TEST_CASE( snapshot_round_trip ) try {
+   tester chain;
+
+   chain.create_accounts( { N(alice), N(bob), N(eosio.token) } );
+   chain.produce_blocks( 2 );
+
+   chain.set_code( N(eosio.token), eosio_token_wast );
+   chain.set_abi( N(eosio.token), eosio_token_abi );
+   chain.produce_blocks();
+
+   chain.push_action( N(eosio.token), N(create), N(eosio.token), mvo()
+      ("issuer", "eosio.token")
+      ("maximum_supply", "1000000.0000 TOK")
+   );
+   chain.push_action( N(eosio.token), N(issue), N(eosio.token), mvo()
+      ("to", "alice")
+      ("quantity", "1000.0000 TOK")
+      ("memo", "")
+   );
+   chain.produce_blocks( 2 );
+
+   std::stringstream snapshot_stream;
+   auto snapshot = take_snapshot( chain, snapshot_stream );
+
+   fc::temp_directory tempdir;
+   tester snap_chain( snapshot_config( chain, tempdir ), snapshot );
+   BOOST_REQUIRE_EQUAL( snap_chain.control->head_block_id(), chain.control->head_block_id() );
+
+   auto symbol_code = symbol::from_string("4,TOK").to_symbol_code().value;
+   BOOST_REQUIRE( snap_chain.get_row_by_account( N(eosio.token), N(alice), N(accounts), symbol_code ) ==
+                  chain.get_row_by_account( N(eosio.token), N(alice), N(accounts), symbol_code ) );
+
+   // blocks produced on the original chain must apply on top of the restored state
+   chain.push_action( N(eosio.token), N(transfer), N(alice), mvo()
+      ("from", "alice")
+      ("to", "bob")
+      ("quantity", "10.0000 TOK")
+      ("memo", "")
+   );
+   for( uint32_t i = 0; i < 3; ++i ) {
+      snap_chain.push_block( chain.produce_block() );
+   }
+   BOOST_REQUIRE_EQUAL( snap_chain.control->head_block_id(), chain.control->head_block_id() );
+   BOOST_REQUIRE( snap_chain.get_row_by_account( N(eosio.token), N(bob), N(accounts), symbol_code ) ==
+                  chain.get_row_by_account( N(eosio.token), N(bob), N(accounts), symbol_code ) );
+
+   // the restored node restarts from its own state and block log
+   snap_chain.close();
+   snap_chain.open();
+   BOOST_REQUIRE_EQUAL( snap_chain.control->head_block_id(), chain.control->head_block_id() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( snapshot_of_other_chain_rejected ) try {
+   tester chain;
+   chain.produce_blocks( 2 );
+
+   std::stringstream snapshot_stream;
+   auto snapshot = take_snapshot( chain, snapshot_stream );
+
+   fc::temp_directory tempdir;
+   auto cfg = snapshot_config( chain, tempdir );
+   cfg.genesis.initial_timestamp = cfg.genesis.initial_timestamp + fc::seconds(1);
+   BOOST_REQUIRE_THROW( tester other_chain( cfg, snapshot ), snapshot_validation_exception );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
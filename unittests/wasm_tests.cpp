@@ -701,6 +701,75 @@ BOOST_FIXTURE_TEST_CASE( check_entry_behavior_2, TESTER ) try {
    BOOST_CHECK_EQUAL(transaction_receipt::executed, receipt.status);
 } FC_LOG_AND_RETHROW()
 
+/**
+ * Contracts released from a full instantiation cache are instantiated again when they are used
+ */
+BOOST_FIXTURE_TEST_CASE( instantiation_cache_eviction, tester ) try {
+   close();
+   cfg.wasm_cache_limits.max_entries = 1;
+   open();
+
+   produce_blocks(2);
+   create_accounts( {N(entrycheck), N(entrycheck2)} );
+   produce_block();
+
+   set_code(N(entrycheck), entry_wast);
+   set_code(N(entrycheck2), entry_wast_2);
+   produce_blocks(2);
+
+   auto run = [&]( account_name contract ) {
+      signed_transaction trx;
+      action act;
+      act.account = contract;
+      act.name = N();
+      act.authorization = vector<permission_level>{{contract,config::active_name}};
+      trx.actions.push_back(act);
+
+      set_transaction_headers(trx);
+      trx.sign(get_private_key( contract, "active" ), control->get_chain_id());
+      auto trace = push_transaction(trx);
+      BOOST_CHECK_EQUAL(transaction_receipt::executed, trace->receipt->status);
+   };
+
+   const auto before = control->get_wasm_interface().get_cache_stats();
+   run(N(entrycheck));
+   run(N(entrycheck2));
+   run(N(entrycheck));
+   const auto after = control->get_wasm_interface().get_cache_stats();
+
+   BOOST_CHECK_EQUAL(after.entries, 1u);
+   // the first two were compiled in the background after setcode, the evicted one is compiled again
+   BOOST_CHECK_GE(after.misses - before.misses, 1u);
+   BOOST_CHECK_GE(after.evictions - before.evictions, 2u);
+} FC_LOG_AND_RETHROW()
+
+/**
+ * The compile that setcode starts in the background is used by the first action sent to the contract
+ */
+BOOST_FIXTURE_TEST_CASE( background_compile_after_setcode, tester ) try {
+   produce_blocks(2);
+   create_accounts( {N(entrycheck)} );
+   produce_block();
+
+   set_code(N(entrycheck), entry_wast);
+
+   const auto before = control->get_wasm_interface().get_cache_stats();
+   signed_transaction trx;
+   action act;
+   act.account = N(entrycheck);
+   act.name = N();
+   act.authorization = vector<permission_level>{{N(entrycheck),config::active_name}};
+   trx.actions.push_back(act);
+   set_transaction_headers(trx);
+   trx.sign(get_private_key( N(entrycheck), "active" ), control->get_chain_id());
+   auto trace = push_transaction(trx);
+   BOOST_CHECK_EQUAL(transaction_receipt::executed, trace->receipt->status);
+   const auto after = control->get_wasm_interface().get_cache_stats();
+
+   BOOST_CHECK_EQUAL(after.hits - before.hits, 1u);
+   BOOST_CHECK_EQUAL(after.misses - before.misses, 0u);
+} FC_LOG_AND_RETHROW()
+
 
 /**
  * Ensure we can load a wasm w/o memory
@@ -1704,6 +1773,40 @@ BOOST_FIXTURE_TEST_CASE( mem_growth_memset, TESTER ) try {
    }
 } FC_LOG_AND_RETHROW()
 
+/**
+ * A contract whose initial memory is mapped from its image, followed by one whose memory is reset by copying,
+ * must not see the image in the pages it grows into
+ */
+BOOST_FIXTURE_TEST_CASE( mem_image_reset, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts( {N(imagelarge), N(imagesmall)} );
+   produce_block();
+
+   set_code(N(imagelarge), memory_image_large);
+   set_code(N(imagesmall), memory_image_small);
+   produce_blocks(1);
+
+   for( int i = 0; i < 3; ++i ) {
+      // what each contract reads from its second page
+      for( auto expected : {std::make_pair(N(imagelarge), "4294967295"), std::make_pair(N(imagesmall), "0")} ) {
+         const auto account = expected.first;
+         signed_transaction trx;
+         action act;
+         act.account = account;
+         act.name = N();
+         act.authorization = vector<permission_level>{{account,config::active_name}};
+         trx.actions.push_back(act);
+         set_transaction_headers(trx);
+         trx.sign(get_private_key( account, "active" ), control->get_chain_id());
+         auto trace = push_transaction(trx);
+         BOOST_REQUIRE_EQUAL(transaction_receipt::executed, trace->receipt->status);
+         BOOST_REQUIRE_EQUAL(trace->action_traces.front().console, expected.second);
+      }
+      produce_blocks(1);
+   }
+} FC_LOG_AND_RETHROW()
+
 INCBIN(fuzz1, "fuzz1.wasm");
 INCBIN(fuzz2, "fuzz2.wasm");
 INCBIN(fuzz3, "fuzz3.wasm");